@@ -27,4 +27,10 @@ if (process.platform === 'win32') { // go to win64 subdirectory
   }
 }
 
-module.exports = require("bindings")("addon.node");
\ No newline at end of file
+const {EventEmitter} = require('events');
+const addon = require("bindings")("addon.node");
+
+// Engine emits 'output' events of eval()
+Object.setPrototypeOf(addon.Engine.prototype, EventEmitter.prototype);
+
+module.exports = addon;
\ No newline at end of file
@@ -1,5 +1,7 @@
+#include "matlab-addon-data.h"
 #include "matlab-engine-js.h"
-// #include "matlab-mxarray.h"
+#include "matlab-engine-pool.h"
+#include "matlab-mxarray.h"
 
 #include <node_api.h>
 
@@ -13,7 +15,9 @@
 //    .getVariable
 //    .setOutputBuffer
 
-napi_value Init(napi_env env, napi_value exports)
+// context-aware: run once per environment (the main thread and each worker thread), each with its own
+// instance data
+NAPI_MODULE_INIT()
 {
   // // define all the class (static) member functions as node.js array
   // napi_property_descriptor desc[] = {
@@ -23,9 +27,10 @@ napi_value Init(napi_env env, napi_value exports)
   // status = napi_define_properties(env, module, sizeof(desc) / sizeof(*desc), desc);
   // assert(status == napi_ok);
 
+  MatlabAddonData::Init(env);
+
   MatlabEngineJS::Init(env, exports);
-  // MatlabMxArray::Init(env, exports);
+  MatlabEnginePool::Init(env, exports);
+  MatlabMxArray::Init(env, exports);
   return exports;
 }
-
-NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <node_api.h>
+
+#include <initializer_list>
+
+/**
+ * \brief Per-environment state of the addon
+ *
+ * Every Node.js environment which loads the addon (the main thread and each
+ * worker thread) gets its own copy, attached as the environment's instance
+ * data. The references are only valid in that environment, so they must never
+ * be shared through static variables.
+ */
+struct MatlabAddonData
+{
+  napi_ref engine_constructor;  // Engine class
+  napi_ref pool_constructor;    // EnginePool class
+  napi_ref mxarray_constructor; // MxArray class
+
+  MatlabAddonData() : engine_constructor(nullptr), pool_constructor(nullptr), mxarray_constructor(nullptr) {}
+
+  /**
+   * \brief Attach a new instance to the environment (called once per environment)
+   */
+  static void Init(napi_env env)
+  {
+    MatlabAddonData *data = new MatlabAddonData;
+    if (napi_set_instance_data(env, data, MatlabAddonData::Finalize, nullptr) != napi_ok)
+    {
+      delete data;
+      napi_fatal_error("MatlabAddonData::Init", NAPI_AUTO_LENGTH, "Failed to set addon instance data.", NAPI_AUTO_LENGTH);
+    }
+  }
+
+  /**
+   * \brief The instance of the environment
+   */
+  static MatlabAddonData &Get(napi_env env)
+  {
+    void *data;
+    if (napi_get_instance_data(env, &data) != napi_ok || !data)
+      napi_fatal_error("MatlabAddonData::Get", NAPI_AUTO_LENGTH, "Addon instance data is not set.", NAPI_AUTO_LENGTH);
+    return *reinterpret_cast<MatlabAddonData *>(data);
+  }
+
+private:
+  static void Finalize(napi_env env, void *data, void * /*hint*/)
+  {
+    MatlabAddonData *obj = reinterpret_cast<MatlabAddonData *>(data);
+    for (napi_ref ref : {obj->engine_constructor, obj->pool_constructor, obj->mxarray_constructor})
+      if (ref)
+        napi_delete_reference(env, ref);
+    delete obj;
+  }
+};
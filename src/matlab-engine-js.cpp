@@ -2,6 +2,9 @@
 #include "napi_utils.h"
 #include "matlab-mxarray-utils.h"
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 
@@ -10,7 +13,6 @@
 std::ofstream os("test.txt", std::fstream::out);
 #endif
 
-napi_ref MatlabEngineJS::constructor;
 
 // macro to create napi_property_descriptor initializer list
 #define DECLARE_NAPI_METHOD(name, func)     \
@@ -24,12 +26,19 @@ napi_value MatlabEngineJS::Init(napi_env env, napi_value exports)
   napi_property_descriptor properties[] = {
       DECLARE_NAPI_METHOD("open", MatlabEngineJS::Open),
       DECLARE_NAPI_METHOD("close", MatlabEngineJS::Close),
-      // DECLARE_NAPI_METHOD("eval", MatlabEngineJS::Eval),
+      DECLARE_NAPI_METHOD("eval", MatlabEngineJS::Eval),
       DECLARE_NAPI_METHOD("evalSync", MatlabEngineJS::EvalSync),
-      // DECLARE_NAPI_METHOD("feval", MatlabEngineJS::Feval),
-      // DECLARE_NAPI_METHOD("fevalSync", MatlabEngineJS::FevalSync),
+      DECLARE_NAPI_METHOD("feval", MatlabEngineJS::Feval),
+      DECLARE_NAPI_METHOD("fevalSync", MatlabEngineJS::FevalSync),
       DECLARE_NAPI_METHOD("getVariable", MatlabEngineJS::GetVariable),
       DECLARE_NAPI_METHOD("putVariable", MatlabEngineJS::PutVariable),
+      DECLARE_NAPI_METHOD("getVariableAsync", MatlabEngineJS::GetVariableAsync),
+      DECLARE_NAPI_METHOD("putVariableAsync", MatlabEngineJS::PutVariableAsync),
+      DECLARE_NAPI_METHOD("getVariables", MatlabEngineJS::GetVariables),
+      DECLARE_NAPI_METHOD("getVariablesSync", MatlabEngineJS::GetVariablesSync),
+      DECLARE_NAPI_METHOD("putVariables", MatlabEngineJS::PutVariables),
+      DECLARE_NAPI_METHOD("putVariablesSync", MatlabEngineJS::PutVariablesSync),
+      DECLARE_NAPI_METHOD("transferTo", MatlabEngineJS::TransferTo),
       {"isOpen", 0, 0, MatlabEngineJS::GetIsOpen, 0, 0, napi_default, nullptr},
       {"visible", 0, 0, MatlabEngineJS::GetVisible, MatlabEngineJS::SetVisible, 0, napi_writable, nullptr},
       {"buffer", 0, 0, MatlabEngineJS::GetBuffer, 0, 0, napi_default, nullptr},
@@ -42,7 +51,7 @@ napi_value MatlabEngineJS::Init(napi_env env, napi_value exports)
                         nullptr, dim(properties), properties, &cons) != napi_ok)
     napi_fatal_error("MatlabEngineJS::Init", NAPI_AUTO_LENGTH, "Failed to define MatlabEngine class.", NAPI_AUTO_LENGTH);
 
-  if (napi_create_reference(env, cons, 1, &MatlabEngineJS::constructor) != napi_ok)
+  if (napi_create_reference(env, cons, 1, &constructor(env)) != napi_ok)
     napi_fatal_error("MatlabEngineJS::Init", NAPI_AUTO_LENGTH, "Failed to create MatlabEngine class reference.", NAPI_AUTO_LENGTH);
 
   if (napi_set_named_property(env, exports, "Engine", cons) != napi_ok)
@@ -55,6 +64,14 @@ napi_value MatlabEngineJS::Init(napi_env env, napi_value exports)
 //   new Matlab.Engine([id],[options])
 //      options <boolean> | <Object>
 //         defer_to_open <boolean> Default: false
+//         startCommand <string> Command to start MATLAB (UNIX), e.g., to run it on another host 
+//                               over ssh. Ignored on Windows, which connects to the shared MATLAB 
+//                               automation server. With it, or on Windows, a timed-out or aborted 
+//                               eval() cannot interrupt MATLAB. Default: '' (local matlab)
+//         shared <boolean> True to use the same MATLAB session as the other shared Engine objects 
+//                          of this process with the same startCommand. close() then only lets go 
+//                          of the session, which is closed once no Engine uses it. The buffer 
+//                          properties remain specific to each Engine object. Default: false
 napi_value MatlabEngineJS::Create(napi_env env, napi_callback_info info)
 {
 #ifdef DEBUG
@@ -79,9 +96,9 @@ napi_value MatlabEngineJS::Create(napi_env env, napi_callback_info info)
       else
         obj = new MatlabEngineJS(env, prhs.jsthis, prhs.argv[0]);
     }
-    catch (...)
+    catch (std::exception &e)
     {
-      napi_throw_error(env, "", "Failed to instantiate MatlabEngine");
+      napi_throw_error(env, "", e.what());
       return nullptr;
     }
 
@@ -90,7 +107,7 @@ napi_value MatlabEngineJS::Create(napi_env env, napi_callback_info info)
   else // Invoked as plain function `MatlabEngineJS(...)`, turn into construct call.
   {
     napi_value cons;
-    if (napi_get_reference_value(env, constructor, &cons) != napi_ok)
+    if (napi_get_reference_value(env, constructor(env), &cons) != napi_ok)
       napi_fatal_error("MatlabEngineJS::Create", NAPI_AUTO_LENGTH, "Failed to call napi_get_reference_value().", NAPI_AUTO_LENGTH);
 
     // call this function again but invoked as constructor
@@ -110,6 +127,13 @@ void MatlabEngineJS::Destructor(napi_env env, void *nativeObject, void * /*final
 
   MatlabEngineJS *obj = reinterpret_cast<MatlabEngineJS *>(nativeObject);
 
+  if (obj->cleanup_hooked_)
+    napi_remove_env_cleanup_hook(env, MatlabEngineJS::Cleanup, obj);
+
+  // collected while still using its engine (e.g., leased and never released)
+  if (obj->eng_ && obj->on_finalize_)
+    obj->on_finalize_(env);
+
   // release the instance from node.js
   if (obj->wrapper_)
     napi_delete_reference(env, obj->wrapper_);
@@ -118,6 +142,21 @@ void MatlabEngineJS::Destructor(napi_env env, void *nativeObject, void * /*final
   delete obj;
 }
 
+void MatlabEngineJS::Cleanup(void *arg)
+{
+  MatlabEngineJS *obj = reinterpret_cast<MatlabEngineJS *>(arg);
+  obj->cleanup_hooked_ = false;
+
+  // the calls of this object completing from now on are discarded (they share tasks_, so they need
+  // not be waited for)
+  obj->tasks_->release();
+
+  // let go of the engine. If this was its last owner, its queued calls fail right away and the running
+  // one is interrupted (see ~MatlabEngine). Otherwise, it is closed by its last owner, which may be in
+  // another environment.
+  obj->detach();
+}
+
 /**
  * \brief Close existing session and destroys the native MatlabEngineJS object
  * 
@@ -297,22 +336,75 @@ napi_value MatlabEngineJS::SetBufferSize(napi_env env, napi_callback_info info)
   return nullptr;
 }
 
+/**
+ * \brief Asynchronously evluates MATLAB expression
+ * 
+ * promise = session.eval(expr[, options])
+ *    options <Object>
+ *       timeout <number>      Time limit in milliseconds once the evaluation starts. Default: none
+ *       signal  <AbortSignal> Aborts the evaluation (or skips it if still queued)
+ * 
+ * The promise resolves with the output buffer (or undefined if disabled). If 
+ * the session has 'output' event listeners, the output is also emitted as one
+ * 'output' event just before the promise resolves. The MATLAB engine only 
+ * hands the output over when the evaluation ends, and no more than bufferSize
+ * characters of it, so the event carries the same capped text: the output 
+ * cannot be streamed while MATLAB runs. A MATLAB error is reported in the output.
+ * 
+ * If the output is not wanted (bufferEnabled is false and there is no 'output' 
+ * listener) and neither timeout nor signal is given, the evaluations queued 
+ * back-to-back are merged into one engine round trip. Each still runs on its 
+ * own, and a MATLAB error, which has no output to go to, rejects its promise
+ * with the error message. With the default bufferEnabled, nothing is merged.
+ * 
+ * If the signal aborts while the evaluation is still queued, the promise rejects
+ * immediately and the evaluation is skipped. On timeout or abort of a running 
+ * evaluation, MATLAB is interrupted and, if it does not return shortly, its 
+ * process is killed. The promise rejects right away and the engine starts a 
+ * new MATLAB session before running the next queued call. A session 
+ * started with a startCommand may run on another host, so it is neither 
+ * interrupted nor killed, and a shared session is never killed: the promise 
+ * then rejects once MATLAB returns from the evaluation. The same goes for all
+ * the sessions on Windows, where the engine connects to the MATLAB automation 
+ * server, which other programs may be using.
+ */
+napi_value MatlabEngineJS::Eval(napi_env env, napi_callback_info info)
+{
+  try
+  { // retrieve the input arguments
+    auto prhs = napi_get_cb_info<MatlabEngineJS>(env, info, 1, 2);
+    if (!prhs.obj)
+      return nullptr;
+
+    return prhs.obj->eval_async(env, prhs.argv[0], prhs.argv.size() > 1 ? prhs.argv[1] : nullptr);
+  }
+  catch (std::exception &e)
+  {
+    napi_throw_error(env, "", e.what());
+    return nullptr;
+  }
+}
+
 /**
  * \brief Synchronously evluates MATLAB expression
  * 
- * session.EvalSync(expr)
+ * session.EvalSync(expr[, options])
  * output = session.EvalSync(expr) - to retrieve output buffer
+ *    options <Object>
+ *       timeout <number> Time limit in milliseconds. Default: none
  * 
+ * On timeout, MATLAB is interrupted or killed as by eval(). A killed session is 
+ * restarted before this function throws.
  */
 napi_value MatlabEngineJS::EvalSync(napi_env env, napi_callback_info info)
 {
   try
   { // retrieve the input arguments
-    auto prhs = napi_get_cb_info<MatlabEngineJS>(env, info, 1, 1);
+    auto prhs = napi_get_cb_info<MatlabEngineJS>(env, info, 1, 2);
     if (!prhs.obj)
       return nullptr;
 
-    prhs.obj->eval(env, prhs.argv[0]);
+    prhs.obj->eval(env, prhs.argv[0], prhs.argv.size() > 1 ? prhs.argv[1] : nullptr);
   }
   catch (std::exception &e)
   {
@@ -321,20 +413,93 @@ napi_value MatlabEngineJS::EvalSync(napi_env env, napi_callback_info info)
   return nullptr;
 }
 
+/**
+ * \brief Asynchronously run MATLAB m-function
+ * 
+ * plhs_promise = session.feval(name, nlhs, ...prhs)
+ * 
+ * The promise resolves with an array of nlhs outputs. The function is called 
+ * through MATLAB's feval() so that a variable of the same name does not shadow
+ * it. The arguments and outputs pass through the workspace variables 
+ * njs_fevalin, njs_fevalout and njs_fevalans, which are overwritten then 
+ * cleared: do not use these names. ans is left as it was.
+ */
+napi_value MatlabEngineJS::Feval(napi_env env, napi_callback_info info)
+{
+  try
+  { // retrieve the input arguments
+    auto prhs = napi_get_cb_info_varargs<MatlabEngineJS>(env, info, 2);
+    if (!prhs.obj)
+      return nullptr;
+
+    return prhs.obj->feval_async(env, prhs.argv);
+  }
+  catch (std::exception &e)
+  {
+    napi_throw_error(env, "", e.what());
+    return nullptr;
+  }
+}
+
+/**
+ * \brief Synchronously run MATLAB m-function
+ * 
+ * plhs = session.fevalSync(name, nlhs, ...prhs)
+ */
+napi_value MatlabEngineJS::FevalSync(napi_env env, napi_callback_info info)
+{
+  try
+  { // retrieve the input arguments
+    auto prhs = napi_get_cb_info_varargs<MatlabEngineJS>(env, info, 2);
+    if (!prhs.obj)
+      return nullptr;
+
+    return prhs.obj->feval(env, prhs.argv);
+  }
+  catch (std::exception &e)
+  {
+    napi_throw_error(env, "", e.what());
+    return nullptr;
+  }
+}
+
 /**
  * \brief Copy variable from MATLAB engine workspace
  * 
- * value = session.GetVariable(name)
+ * value = session.GetVariable(name[, options])
+ *    options <Object>
+ *       copy <boolean> False to reference the MATLAB array data from typed arrays. Default: true
+ *       packLogicals <boolean> True to return logical arrays as bitsets (see below). Default: false
+ *       interleavedComplex <boolean> True to return complex arrays as one typed array 
+ *                                    [re0, im0, re1, im1, ...] with complex property set to true.
+ *                                    Default: false
+ *       columnar <boolean> True to return a struct array as one object of field columns: a typed
+ *                          array for a field of numeric or logical scalars, an array of strings
+ *                          for a field of character vectors, and an array of values otherwise.
+ *                          Default: false
+ *       handle <boolean> True to return the array as an MxArray object without converting it. 
+ *                        Default: false
+ * 
+ * Non-scalar logical arrays are returned as Uint8Array with logical property set to true, 
+ * one byte per element or, if packed (packed property set to true), one bit per element 
+ * with element i in bit (i % 8) of byte (i / 8). putVariable() turns them back into logical 
+ * arrays.
+ * 
+ * Sparse matrices are returned in compressed sparse column form {m, n, ir, jc, pr[, pi]} 
+ * with sparse property set to true: ir (row indices of nonzero elements, 0-based) and jc 
+ * (column offsets, n+1 elements) are Int32Array or, with 64-bit MATLAB indices, BigInt64Array.
+ * With copy set to false, they reference the MATLAB array data. putVariable() accepts the
+ * same form (sparse must be true), rejecting invalid indices.
  */
 napi_value MatlabEngineJS::GetVariable(napi_env env, napi_callback_info info)
 {
   try
   { // retrieve the input arguments
-    auto prhs = napi_get_cb_info<MatlabEngineJS>(env, info, 1, 1);
+    auto prhs = napi_get_cb_info<MatlabEngineJS>(env, info, 1, 2);
     if (!prhs.obj)
       return nullptr;
 
-    return prhs.obj->get_variable(env, prhs.argv[0]);
+    return prhs.obj->get_variable(env, prhs.argv[0], prhs.argv.size() > 1 ? prhs.argv[1] : nullptr);
   }
   catch (std::exception &e)
   {
@@ -345,17 +510,178 @@ napi_value MatlabEngineJS::GetVariable(napi_env env, napi_callback_info info)
 
 /**
  * \brief Put variable into MATLAB engine workspace
- * session.PutVariable(name, value)
+ * session.PutVariable(name, value[, options])
+ *    value may be an MxArray object, which is sent without conversion
+ *    A typed array is shaped by its dims property (as attached by getVariable()), or value
+ *    may be given as {data: TypedArray, dims: [...]}. Without dims, it becomes a column vector.
+ *    options <Object> Accepted for symmetry with putVariableAsync(). The value is always 
+ *                     copied: engPutVariable() needs an mxArray whose data MATLAB allocated.
  */
 napi_value MatlabEngineJS::PutVariable(napi_env env, napi_callback_info info)
 {
   try
   { // retrieve the input arguments
-    auto prhs = napi_get_cb_info<MatlabEngineJS>(env, info, 2, 2);
+    auto prhs = napi_get_cb_info<MatlabEngineJS>(env, info, 2, 3);
+    if (!prhs.obj)
+      return nullptr;
+
+    prhs.obj->put_variable(env, prhs.argv[0], prhs.argv[1], prhs.argv.size() > 2 ? prhs.argv[2] : nullptr);
+  }
+  catch (std::exception &e)
+  {
+    napi_throw_error(env, "", e.what());
+  }
+  return nullptr;
+}
+
+/**
+ * \brief Asynchronously copy variable from MATLAB engine workspace
+ * 
+ * value_promise = session.getVariableAsync(name[, options])
+ *    options <Object> Same as getVariable()
+ * 
+ * Queued behind the pending asynchronous calls of the session, which the engine 
+ * runs back-to-back. The contents of large typed arrays are filled on the engine 
+ * thread, leaving the JavaScript thread only to wrap them.
+ */
+napi_value MatlabEngineJS::GetVariableAsync(napi_env env, napi_callback_info info)
+{
+  try
+  { // retrieve the input arguments
+    auto prhs = napi_get_cb_info<MatlabEngineJS>(env, info, 1, 2);
+    if (!prhs.obj)
+      return nullptr;
+
+    return prhs.obj->get_variable_async(env, prhs.argv[0], prhs.argv.size() > 1 ? prhs.argv[1] : nullptr);
+  }
+  catch (std::exception &e)
+  {
+    napi_throw_error(env, "", e.what());
+    return nullptr;
+  }
+}
+
+/**
+ * \brief Asynchronously put variable into MATLAB engine workspace
+ * 
+ * done_promise = session.putVariableAsync(name, value[, options])
+ *    options <Object>
+ *       copy <boolean> False to let the engine thread copy a large shared typed array (see below). Default: true
+ * 
+ * The value is converted before this function returns. With copy set to false, a large
+ * numeric typed array backed by a SharedArrayBuffer is instead copied by the engine thread,
+ * so it must not be modified until the promise settles. Other typed arrays are always copied
+ * right away as their buffers may be transferred or detached.
+ */
+napi_value MatlabEngineJS::PutVariableAsync(napi_env env, napi_callback_info info)
+{
+  try
+  { // retrieve the input arguments
+    auto prhs = napi_get_cb_info<MatlabEngineJS>(env, info, 2, 3);
+    if (!prhs.obj)
+      return nullptr;
+
+    return prhs.obj->put_variable_async(env, prhs.argv[0], prhs.argv[1], prhs.argv.size() > 2 ? prhs.argv[2] : nullptr);
+  }
+  catch (std::exception &e)
+  {
+    napi_throw_error(env, "", e.what());
+    return nullptr;
+  }
+}
+
+/**
+ * \brief Asynchronously copy variables from MATLAB engine workspace
+ * 
+ * values_promise = session.getVariables(names[, options])
+ *    names   <string[]> Names of the variables
+ *    options <Object> Same as getVariable()
+ * 
+ * The promise resolves with an object whose properties are the variables.
+ */
+napi_value MatlabEngineJS::GetVariables(napi_env env, napi_callback_info info)
+{
+  try
+  { // retrieve the input arguments
+    auto prhs = napi_get_cb_info<MatlabEngineJS>(env, info, 1, 2);
+    if (!prhs.obj)
+      return nullptr;
+
+    return prhs.obj->get_variables_async(env, prhs.argv[0], prhs.argv.size() > 1 ? prhs.argv[1] : nullptr);
+  }
+  catch (std::exception &e)
+  {
+    napi_throw_error(env, "", e.what());
+    return nullptr;
+  }
+}
+
+/**
+ * \brief Synchronously copy variables from MATLAB engine workspace
+ * 
+ * values = session.getVariablesSync(names[, options])
+ */
+napi_value MatlabEngineJS::GetVariablesSync(napi_env env, napi_callback_info info)
+{
+  try
+  { // retrieve the input arguments
+    auto prhs = napi_get_cb_info<MatlabEngineJS>(env, info, 1, 2);
+    if (!prhs.obj)
+      return nullptr;
+
+    return prhs.obj->get_variables(env, prhs.argv[0], prhs.argv.size() > 1 ? prhs.argv[1] : nullptr);
+  }
+  catch (std::exception &e)
+  {
+    napi_throw_error(env, "", e.what());
+    return nullptr;
+  }
+}
+
+/**
+ * \brief Asynchronously put variables into MATLAB engine workspace
+ * 
+ * done_promise = session.putVariables(values[, options])
+ *    values  <Object> Variables to assign, keyed by their names
+ *    options <Object> Same as putVariableAsync()
+ * 
+ * The values are converted before this function returns. With copy set to false, large
+ * numeric typed arrays backed by SharedArrayBuffers are instead copied by the engine thread,
+ * so they must not be modified until the promise settles. Other typed arrays are always
+ * copied right away as their buffers may be transferred or detached.
+ */
+napi_value MatlabEngineJS::PutVariables(napi_env env, napi_callback_info info)
+{
+  try
+  { // retrieve the input arguments
+    auto prhs = napi_get_cb_info<MatlabEngineJS>(env, info, 1, 2);
+    if (!prhs.obj)
+      return nullptr;
+
+    return prhs.obj->put_variables_async(env, prhs.argv[0], prhs.argv.size() > 1 ? prhs.argv[1] : nullptr);
+  }
+  catch (std::exception &e)
+  {
+    napi_throw_error(env, "", e.what());
+    return nullptr;
+  }
+}
+
+/**
+ * \brief Synchronously put variables into MATLAB engine workspace
+ * 
+ * session.putVariablesSync(values[, options])
+ *    options <Object> Same as putVariable()
+ */
+napi_value MatlabEngineJS::PutVariablesSync(napi_env env, napi_callback_info info)
+{
+  try
+  { // retrieve the input arguments
+    auto prhs = napi_get_cb_info<MatlabEngineJS>(env, info, 1, 2);
     if (!prhs.obj)
       return nullptr;
 
-    prhs.obj->put_variable(env, prhs.argv[0], prhs.argv[1]);
+    prhs.obj->put_variables(env, prhs.argv[0], prhs.argv.size() > 1 ? prhs.argv[1] : nullptr);
   }
   catch (std::exception &e)
   {
@@ -364,10 +690,35 @@ napi_value MatlabEngineJS::PutVariable(napi_env env, napi_callback_info info)
   return nullptr;
 }
 
+/**
+ * \brief Copy variable from this engine's workspace to another engine's
+ * 
+ * done_promise = session.transferTo(dst_session, src_name[, dst_name])
+ *    The variable is never converted to a JavaScript value. dst_name defaults
+ *    to src_name.
+ */
+napi_value MatlabEngineJS::TransferTo(napi_env env, napi_callback_info info)
+{
+  try
+  { // retrieve the input arguments
+    auto prhs = napi_get_cb_info<MatlabEngineJS>(env, info, 2, 3);
+    if (!prhs.obj)
+      return nullptr;
+
+    return prhs.obj->transfer_to(env, prhs.argv[0], prhs.argv[1], prhs.argv.size() > 2 ? prhs.argv[2] : nullptr);
+  }
+  catch (std::exception &e)
+  {
+    napi_throw_error(env, "", e.what());
+    return nullptr;
+  }
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 MatlabEngineJS::MatlabEngineJS(napi_env env, napi_value jsthis, napi_value opt_value)
-    : eng_(256, true), wrapper_(nullptr)
+    : wrapper_(nullptr), cleanup_hooked_(false), tasks_(std::make_shared<NapiTaskDispatcher>()),
+      shared_(false), bufena_(true), bufsz_(256), buf_(std::make_shared<std::string>())
 {
 #ifdef DEBUG
   os << "MatlabEngineJS::MatlabEngineJS" << std::endl;
@@ -375,45 +726,120 @@ MatlabEngineJS::MatlabEngineJS(napi_env env, napi_value jsthis, napi_value opt_v
 
   // parse inputs
   bool defer_open = false;
-  if (opt_value)
+  bool shared = false;
+  std::string startcmd;
+  napi_valuetype opt_type = napi_undefined;
+  if (opt_value && napi_typeof(env, opt_value, &opt_type) != napi_ok)
+    throw std::runtime_error("Failed to get the type of the option argument.");
+
+  if (opt_type == napi_external)
+  {
+    // internal use (see NewInstance()): share an existing engine
+    void *data;
+    if (napi_get_value_external(env, opt_value, &data) != napi_ok)
+      throw std::runtime_error("Failed to retrieve the engine to share.");
+    eng_ = *reinterpret_cast<std::shared_ptr<MatlabEngine> *>(data);
+    defer_open = true;
+  }
+  else if (opt_type == napi_boolean)
+  {
+    // if boolean type, defer_open option directly given
+    defer_open = value2bool(env, opt_value);
+  }
+  else if (opt_value)
   {
+    // else, look for defer_open property
     try
     {
-      // if boolean type, defer_open option directly given
-      defer_open = value2bool(env, opt_value);
+      defer_open = napi_get_option_bool(env, opt_value, "defer_to_open", false);
+      startcmd = napi_get_option_string(env, opt_value, "startCommand", startcmd);
+      shared = napi_get_option_bool(env, opt_value, "shared", false);
     }
     catch (...)
     {
-      // else, look for defer_open property
-      try
-      {
-        bool has_prop;
-        if (napi_has_named_property(env, opt_value, "defer_to_open", &has_prop) == napi_ok && has_prop)
-        {
-          if (napi_get_named_property(env, opt_value, "defer_to_open", &opt_value) != napi_ok)
-            throw;
-          defer_open = value2bool(env, opt_value);
-        }
-      }
-      catch (...)
-      {
-        throw std::runtime_error("Matlab Engine ID must be a double value.");
-      }
+      throw std::runtime_error("Invalid MatlabEngine option.");
     }
   }
 
-  // Wraps the new native instance in a JavaScript object.
-  napi_status status = napi_wrap(env, jsthis, this, MatlabEngineJS::Destructor, nullptr, &wrapper_);
-  assert(status == napi_ok);
+  shared_ = shared;
+  startcmd_ = startcmd;
+  if (!eng_)
+    eng_ = shared ? shared_engine(startcmd) : std::make_shared<MatlabEngine>(true, startcmd);
 
   // open MATLAB session if not deferred
   if (!defer_open)
-    eng_.open();
+    eng().open();
+
+  // Wraps the new native instance in a JavaScript object. Nothing may throw once it is wrapped, as
+  // the failed construction frees this object, which the Destructor would then delete again.
+  if (napi_create_reference(env, jsthis, 0, &wrapper_) != napi_ok)
+    throw std::runtime_error("Failed to reference the MatlabEngine object.");
+  try
+  {
+    // prepare to receive the results of asynchronous calls
+    tasks_->init(env, wrapper_, "MatlabEngine");
+    if (napi_wrap(env, jsthis, this, MatlabEngineJS::Destructor, nullptr, nullptr) != napi_ok)
+      throw std::runtime_error("Failed to wrap the MatlabEngine object.");
+  }
+  catch (...)
+  {
+    tasks_->release();
+    napi_delete_reference(env, wrapper_);
+    wrapper_ = nullptr;
+    throw;
+  }
+  cleanup_hooked_ = napi_add_env_cleanup_hook(env, MatlabEngineJS::Cleanup, this) == napi_ok;
+}
+
+napi_value MatlabEngineJS::NewInstance(napi_env env, std::shared_ptr<MatlabEngine> engine)
+{
+  napi_value cons, arg, instance;
+  if (napi_get_reference_value(env, constructor(env), &cons) != napi_ok)
+    throw std::runtime_error("Failed to get MatlabEngine class constructor.");
+
+  // the external only lives during the constructor call
+  if (napi_create_external(env, &engine, nullptr, nullptr, &arg) != napi_ok)
+    throw std::runtime_error("Failed to create external value.");
+
+  if (napi_new_instance(env, cons, 1, &arg, &instance) != napi_ok)
+    throw std::runtime_error("Failed to create MatlabEngine object.");
+
+  return instance;
+}
+
+MatlabEngineJS *MatlabEngineJS::Unwrap(napi_env env, napi_value value)
+{
+  napi_value cons;
+  bool is_engine;
+  if (napi_get_reference_value(env, constructor(env), &cons) != napi_ok ||
+      napi_instanceof(env, value, cons, &is_engine) != napi_ok)
+    throw std::runtime_error("Failed to check for MatlabEngine object.");
+
+  MatlabEngineJS *obj(nullptr);
+  if (!is_engine || napi_unwrap(env, value, reinterpret_cast<void **>(&obj)) != napi_ok)
+    throw std::runtime_error("Not a MatlabEngine object.");
+  return obj;
+}
+
+std::shared_ptr<MatlabEngine> MatlabEngineJS::detach()
+{
+  std::shared_ptr<MatlabEngine> rval;
+  rval.swap(eng_);
+  return rval;
+}
+
+MatlabEngine &MatlabEngineJS::eng()
+{
+  if (!eng_)
+    throw std::runtime_error("MATLAB session has been released.");
+  return *eng_;
 }
 
 void MatlabEngineJS::open()
 {
-  eng_.open();
+  if (!eng_ && shared_) // reconnect after close()
+    eng_ = shared_engine(startcmd_);
+  eng().open();
 }
 
 /**
@@ -426,14 +852,40 @@ void MatlabEngineJS::open()
  */
 void MatlabEngineJS::close()
 {
+  if (shared_) // others may still use it: let go (closed with the last reference)
+  {
+    eng_.reset();
+    return;
+  }
+
   // remove the C++ object from Node wrapper object
-  eng_.close();
+  eng().close();
+}
+
+std::shared_ptr<MatlabEngine> MatlabEngineJS::shared_engine(const std::string &startcmd)
+{
+  // process-wide, so that the engines are shared across worker threads too
+  static std::mutex m;
+  static std::map<std::string, std::weak_ptr<MatlabEngine>> engines;
+
+  std::lock_guard<std::mutex> guard(m);
+  for (auto it = engines.begin(); it != engines.end();) // forget the closed ones
+    it = it->second.expired() ? engines.erase(it) : std::next(it);
+
+  std::shared_ptr<MatlabEngine> eng = engines[startcmd].lock();
+  if (!eng)
+  {
+    eng = std::make_shared<MatlabEngine>(true, startcmd);
+    eng->setKillable(false); // a runaway call of one user must not kill the session of the others
+    engines[startcmd] = eng;
+  }
+  return eng;
 }
 
 napi_value MatlabEngineJS::is_open(napi_env env)
 {
   napi_value rval = nullptr;
-  if (napi_get_boolean(env, eng_.isopen(), &rval) != napi_ok)
+  if (napi_get_boolean(env, eng_ && eng_->isopen(), &rval) != napi_ok)
     napi_throw_error(env, "", "napi_get_boolean() failed.");
   return rval;
 }
@@ -441,7 +893,7 @@ napi_value MatlabEngineJS::is_open(napi_env env)
 napi_value MatlabEngineJS::get_visible(napi_env env)
 {
   napi_value rval = nullptr;
-  if (napi_get_boolean(env, eng_.getVisible(), &rval) != napi_ok)
+  if (napi_get_boolean(env, eng().getVisible(), &rval) != napi_ok)
     napi_throw_error(env, "", "napi_get_boolean() failed.");
   return rval;
 }
@@ -449,7 +901,7 @@ napi_value MatlabEngineJS::get_visible(napi_env env)
 napi_value MatlabEngineJS::get_buffer_enabled(napi_env env)
 {
   napi_value rval = nullptr;
-  if (napi_get_boolean(env, eng_.getBufferEnabled(), &rval) != napi_ok)
+  if (napi_get_boolean(env, bufena_, &rval) != napi_ok)
     napi_throw_error(env, "", "napi_get_boolean() failed.");
   return rval;
 }
@@ -457,14 +909,14 @@ napi_value MatlabEngineJS::get_buffer_enabled(napi_env env)
 napi_value MatlabEngineJS::get_buffer_size(napi_env env)
 {
   napi_value rval = nullptr;
-  if (napi_create_double(env, (double)eng_.getBufferSize(), &rval) != napi_ok)
+  if (napi_create_double(env, (double)bufsz_, &rval) != napi_ok)
     napi_throw_error(env, "", "napi_create_double() failed.");
   return rval;
 }
 
 napi_value MatlabEngineJS::get_buffer(napi_env env)
 {
-  const std::string &buf = eng_.getBuffer();
+  const std::string &buf = *buf_;
   napi_value rval = nullptr;
   if (buf.empty() || buf[0] == '\0')
   {
@@ -481,28 +933,44 @@ napi_value MatlabEngineJS::get_buffer(napi_env env)
 
 void MatlabEngineJS::set_visible(napi_env env, napi_value value)
 {
-  eng_.setVisible(value2bool(env, value));
+  eng().setVisible(value2bool(env, value));
 }
 
 void MatlabEngineJS::set_buffer_enabled(napi_env env, napi_value value)
 {
-  eng_.setBufferEnabled(value2bool(env, value));
+  bufena_ = value2bool(env, value);
+  if (!bufena_) // if disabled, clear current buffer content
+    buf_->clear();
 }
 
 void MatlabEngineJS::set_buffer_size(napi_env env, napi_value value)
 {
-  eng_.setBufferSize(value2uint32(env, value));
+  if (uint32_t sz = value2uint32(env, value)) // if 0, unchanged
+    bufsz_ = sz;
 }
 
-napi_value MatlabEngineJS::eval(napi_env env, napi_value jsexpr)
+napi_value MatlabEngineJS::eval(napi_env env, napi_value jsexpr, napi_value jsopts)
 {
+  uint32_t timeout = napi_get_option_uint32(env, jsopts, "timeout", 0);
+  MatlabCallControl ctl{std::chrono::milliseconds(timeout)};
+
   // evaluate the expression
-  const std::string &strout = eng_.eval(napi_get_value_string_utf8(env, jsexpr));
+  std::string output;
+  try
+  {
+    output = eng().eval(napi_get_value_string_utf8(env, jsexpr), bufena_ ? bufsz_ : 0, timeout ? &ctl : nullptr);
+  }
+  catch (...)
+  {
+    eng().recover(); // restart MATLAB if it had to be killed
+    throw;
+  }
 
   napi_value rval;
-  if (eng_.getBufferEnabled()) // output returned
+  if (bufena_) // output returned
   {
-    if (napi_create_string_utf8(env, eng_.getBuffer().c_str(), NAPI_AUTO_LENGTH, &rval) != napi_ok)
+    *buf_ = std::move(output);
+    if (napi_create_string_utf8(env, buf_->c_str(), NAPI_AUTO_LENGTH, &rval) != napi_ok)
       throw std::runtime_error("Failed to create string output.");
   }
   else // output not returned
@@ -513,43 +981,834 @@ napi_value MatlabEngineJS::eval(napi_env env, napi_value jsexpr)
   return rval;
 }
 
-napi_value MatlabEngineJS::get_variable(napi_env env, napi_value jsname)
+namespace
 {
+/**
+ * \brief Asynchronous evaluation of a MATLAB expression without output
+ * 
+ * Queued with MatlabEngine::postEval(), which merges it with adjacent ones. As the output is
+ * discarded, a MATLAB error rejects the promise.
+ */
+class QuietEvalTask : public NapiAsyncTask
+{
+public:
+  explicit QuietEvalTask(napi_env env) : NapiAsyncTask(env) {}
 
-  // get the variable from MATLAB
-  managedMxArray val(eng_.getVariable(napi_get_value_string_utf8(env, jsname).c_str()), mxDestroyArray);
-  if (!val)
-    throw std::runtime_error("Failed to retrieve the requested Matlab variable.");
-
-  // convert mxArray to napi_value
-  return mxArrayToNapiValue(env, val.get());
+  /**
+   * \brief Record the outcome of the evaluation (worker thread)
+   */
+  void done(const std::string &error) { error_ = error; }
 
-  // // create mxarray object and return it...
-  // napi_value cons;
-  // status = napi_get_reference_value(env, MatlabMxArray::constructor, &cons);
-  // assert(status == napi_ok);
+protected:
+  void execute() override
+  {
+    if (!error_.empty())
+      throw std::runtime_error(error_);
+  }
 
-  // // call this function again but invoked as constructor
-  // napi_value instance;
-  // status = napi_new_instance(env, cons, 0, nullptr, &instance);
-  // assert(status == napi_ok);
+private:
+  std::string error_;
+};
 
-  // MatlabMxArray *array;
-  // status = napi_unwrap(env, instance, reinterpret_cast<void **>(&array));
-  // assert(status == napi_ok);
-  // array->setMxArray(val); // responsible to delete mxArray
+/**
+ * \brief Cancels a MatlabCallControl when an AbortSignal fires, while attached
+ * 
+ * If the call has not started yet, the promise of its task is rejected right away.
+ */
+class AbortListener
+{
+public:
+  AbortListener() : signal_(nullptr), listener_(nullptr) {}
 
-  // return instance;
-}
+  ~AbortListener() // if never detached (task not dispatched or environment torn down)
+  {
+    if (target_)
+      target_->task = nullptr;
+  }
 
-void MatlabEngineJS::put_variable(napi_env env, napi_value jsname, napi_value jsvalue)
-{
+  /**
+   * \brief Add the abort event listener to signal (or cancel right away if already aborted)
+   */
+  void attach(napi_env env, napi_value signal, const std::shared_ptr<MatlabCallControl> &ctl, NapiAsyncTask *task)
+  {
+    if (napi_get_option_bool(env, signal, "aborted", false))
+    {
+      if (ctl->cancel())
+        task->reject(env, ctl->reason());
+      return;
+    }
+
+    // the listener owns a reference to ctl until it is garbage collected
+    target_ = std::make_shared<Target>(Target{ctl, task});
+    auto *holder = new std::shared_ptr<Target>(target_);
+    napi_value listener;
+    if (napi_create_function(env, "onabort", NAPI_AUTO_LENGTH, AbortListener::on_abort, holder, &listener) != napi_ok)
+    {
+      delete holder;
+      throw std::runtime_error("Failed to create abort event listener.");
+    }
+    if (napi_add_finalizer(env, listener, holder, AbortListener::finalize, nullptr, nullptr) != napi_ok)
+      throw std::runtime_error("Failed to create abort event listener."); // holder stays with the function
+
+    call(env, signal, "addEventListener", listener);
+    if (napi_create_reference(env, signal, 1, &signal_) != napi_ok ||
+        napi_create_reference(env, listener, 1, &listener_) != napi_ok)
+      throw std::runtime_error("Failed to reference AbortSignal.");
+  }
+
+  /**
+   * \brief Remove the listener
+   */
+  void detach(napi_env env) noexcept
+  {
+    napi_value signal, listener;
+    if (signal_ && listener_ &&
+        napi_get_reference_value(env, signal_, &signal) == napi_ok &&
+        napi_get_reference_value(env, listener_, &listener) == napi_ok)
+    {
+      try
+      {
+        call(env, signal, "removeEventListener", listener);
+      }
+      catch (...)
+      {
+      }
+    }
+
+    if (target_) // the task is going away
+      target_->task = nullptr;
+    if (signal_)
+      napi_delete_reference(env, signal_);
+    if (listener_)
+      napi_delete_reference(env, listener_);
+    signal_ = listener_ = nullptr;
+    target_.reset();
+  }
+
+private:
+  /**
+   * \brief Data of the listener function
+   */
+  struct Target
+  {
+    std::shared_ptr<MatlabCallControl> ctl;
+    NapiAsyncTask *task; // nullptr once detached
+  };
+
+  static void call(napi_env env, napi_value signal, const char *method, napi_value listener)
+  {
+    napi_value fn, argv[2], result;
+    if (napi_get_named_property(env, signal, method, &fn) != napi_ok ||
+        napi_create_string_utf8(env, "abort", NAPI_AUTO_LENGTH, &argv[0]) != napi_ok ||
+        napi_call_function(env, signal, fn, 2, (argv[1] = listener, argv), &result) != napi_ok)
+      throw std::runtime_error(std::string("Failed to call AbortSignal.") + method + "().");
+  }
+
+  static napi_value on_abort(napi_env env, napi_callback_info info)
+  {
+    void *data;
+    if (napi_get_cb_info(env, info, nullptr, nullptr, nullptr, &data) != napi_ok)
+      return nullptr;
+
+    Target *target = reinterpret_cast<std::shared_ptr<Target> *>(data)->get();
+    if (target->ctl->cancel() && target->task) // still queued: skipped by the worker
+      target->task->reject(env, target->ctl->reason());
+    return nullptr;
+  }
+
+  static void finalize(napi_env /*env*/, void *data, void * /*hint*/)
+  {
+    delete reinterpret_cast<std::shared_ptr<Target> *>(data);
+  }
+
+  napi_ref signal_;
+  napi_ref listener_;
+  std::shared_ptr<Target> target_; // shared with the listener, which may be collected first
+};
+
+/**
+ * \brief Emit an event on an EventEmitter object with a string argument
+ * 
+ * An exception thrown by a listener is reported as uncaught.
+ */
+void emit_event(napi_env env, napi_value emitter, const char *event, const std::string &text)
+{
+  napi_value emit_fn, argv[2], result;
+  napi_valuetype type;
+  if (napi_get_named_property(env, emitter, "emit", &emit_fn) == napi_ok &&
+      napi_typeof(env, emit_fn, &type) == napi_ok && type == napi_function &&
+      napi_create_string_utf8(env, event, NAPI_AUTO_LENGTH, &argv[0]) == napi_ok &&
+      napi_create_string_utf8(env, text.data(), text.size(), &argv[1]) == napi_ok &&
+      napi_call_function(env, emitter, emit_fn, 2, argv, &result) == napi_pending_exception)
+  {
+    napi_value err;
+    if (napi_get_and_clear_last_exception(env, &err) == napi_ok)
+      napi_fatal_exception(env, err);
+  }
+}
+
+/**
+ * \brief True if the EventEmitter object has listeners of the event
+ */
+bool has_listeners(napi_env env, napi_value emitter, const char *event)
+{
+  napi_value fn, name, count;
+  napi_valuetype type;
+  if (napi_get_named_property(env, emitter, "listenerCount", &fn) != napi_ok ||
+      napi_typeof(env, fn, &type) != napi_ok || type != napi_function)
+    return false; // not an EventEmitter
+
+  if (napi_create_string_utf8(env, event, NAPI_AUTO_LENGTH, &name) != napi_ok ||
+      napi_call_function(env, emitter, fn, 1, &name, &count) != napi_ok)
+    throw std::runtime_error("Failed to count event listeners.");
+  return value2uint32(env, count) > 0;
+}
+
+/**
+ * \brief Asynchronous evaluation of a MATLAB expression
+ */
+class EvalTask : public NapiAsyncTask
+{
+public:
+  /**
+   * \param[in] bufsz    Output buffer size
+   * \param[in] buffer   Receives the output once the promise resolves with it, or nullptr to discard it
+   * \param[in] emitter  EventEmitter to emit the output from as an 'output' event, or nullptr
+   * \param[in] ctl      Time limit and cancellation of the evaluation, or nullptr
+   * \param[in] signal   AbortSignal to cancel ctl with, or nullptr
+   */
+  EvalTask(napi_env env, MatlabEngine &eng, std::string &&expr, const size_t bufsz, std::shared_ptr<std::string> buffer,
+           napi_value emitter = nullptr, std::shared_ptr<MatlabCallControl> ctl = nullptr, napi_value signal = nullptr)
+      : NapiAsyncTask(env), eng_(eng), expr_(std::move(expr)), bufsz_(bufsz), buffer_(std::move(buffer)),
+        emitter_(nullptr), ctl_(std::move(ctl))
+  {
+    if (emitter && napi_create_reference(env, emitter, 1, &emitter_) != napi_ok)
+      throw std::runtime_error("Failed to reference MatlabEngine object.");
+
+    try
+    {
+      if (ctl_ && signal)
+        abort_.attach(env, signal, ctl_, this);
+    }
+    catch (...)
+    {
+      cleanup(env);
+      throw;
+    }
+  }
+
+protected:
+  void execute() override
+  {
+    if (ctl_ && ctl_->cancelled()) // aborted while queued (promise already rejected)
+      throw std::runtime_error(ctl_->reason());
+
+    output_ = eng_.eval(expr_, buffer_ || emitter_ ? bufsz_ : 0, ctl_.get());
+  }
+
+  napi_value complete(napi_env env) override
+  {
+    napi_value emitter;
+    if (emitter_ && !output_.empty() && napi_get_reference_value(env, emitter_, &emitter) == napi_ok && emitter)
+      emit_event(env, emitter, "output", output_); // before resolving
+
+    napi_value rval(nullptr);
+    if (!buffer_)
+      return rval;
+    *buffer_ = output_;
+    if (napi_create_string_utf8(env, output_.c_str(), NAPI_AUTO_LENGTH, &rval) != napi_ok)
+      throw std::runtime_error("Failed to create string output.");
+    return rval;
+  }
+
+  void cleanup(napi_env env) override
+  {
+    abort_.detach(env);
+    if (emitter_)
+      napi_delete_reference(env, emitter_);
+    emitter_ = nullptr;
+  }
+
+private:
+  MatlabEngine &eng_;
+  std::string expr_;
+  size_t bufsz_;
+  std::shared_ptr<std::string> buffer_; // session.buffer
+  std::string output_;
+  napi_ref emitter_;
+  std::shared_ptr<MatlabCallControl> ctl_;
+  AbortListener abort_;
+};
+
+/**
+ * \brief Convert feval() JavaScript arguments: (name, nargout, ...args)
+ */
+void feval_args(napi_env env, const std::vector<napi_value> &argv, std::string &name, int &nargout, managedMxArray &args)
+{
+  name = napi_get_value_string_utf8(env, argv[0]);
+  nargout = (int)value2uint32(env, argv[1]);
+
+  size_t nargin = argv.size() - 2;
+  args.reset(mxCreateCellMatrix(1, nargin));
+  for (size_t i = 0; i < nargin; ++i)
+    mxSetCell(args.get(), i, napiValueToMxArray(env, argv[i + 2]));
+}
+
+/**
+ * \brief Convert the cell array of feval() outputs to a JavaScript array
+ */
+napi_value feval_outputs(napi_env env, const mxArray *outs, const MxArrayToNapiOptions &opts = MxArrayToNapiOptions())
+{
+  napi_value rval;
+  uint32_t nargout = (uint32_t)mxGetNumberOfElements(outs);
+  if (napi_create_array_with_length(env, nargout, &rval) != napi_ok)
+    throw std::runtime_error("Failed to create JavaScript array.");
+  for (uint32_t i = 0; i < nargout; ++i)
+  {
+    if (napi_set_element(env, rval, i, mxArrayToNapiValue(env, mxGetCell(outs, i), opts)) != napi_ok)
+      throw std::runtime_error("Failed to set an JavaScript array element.");
+  }
+  return rval;
+}
+
+/**
+ * \brief Asynchronous evaluation of a MATLAB function
+ */
+class FevalTask : public NapiAsyncTask
+{
+public:
+  FevalTask(napi_env env, MatlabEngine &eng, const std::vector<napi_value> &argv)
+      : NapiAsyncTask(env), eng_(eng), nargout_(0), args_(nullptr, mxDestroyArray), outs_(nullptr, mxDestroyArray)
+  {
+    // arguments are converted here on the JavaScript thread
+    feval_args(env, argv, name_, nargout_, args_);
+  }
+
+protected:
+  void execute() override
+  {
+    outs_.reset(eng_.feval(name_, nargout_, args_.get()));
+    args_.reset();
+
+    // fill the large typed arrays here so that complete() only wraps them
+    if (outs_)
+    {
+      auto buffers = std::make_shared<MxArrayBuffers>();
+      prepare_mxarray_buffers(outs_.get(), opts_, *buffers);
+      opts_.buffers = buffers;
+    }
+  }
+
+  napi_value complete(napi_env env) override
+  {
+    return feval_outputs(env, outs_.get(), opts_);
+  }
+
+private:
+  MatlabEngine &eng_;
+  std::string name_;
+  int nargout_;
+  managedMxArray args_;
+  managedMxArray outs_;
+  MxArrayToNapiOptions opts_;
+};
+
+/**
+ * \brief Asynchronous variable transfer between two engines
+ * 
+ * fetch() runs on the source engine's worker thread and execute() on the 
+ * destination's, so neither worker waits for the other.
+ */
+class TransferTask : public NapiAsyncTask
+{
+public:
+  TransferTask(napi_env env, std::shared_ptr<MatlabEngine> dst, std::string &&src_name, std::string &&dst_name)
+      : NapiAsyncTask(env), dst_(dst), src_name_(std::move(src_name)), dst_name_(std::move(dst_name)),
+        val_(nullptr, mxDestroyArray) {}
+
+  ~TransferTask() { MatlabEngine::release(dst_); } // may be on the destination's worker
+
+  /**
+   * \brief Get the variable from the source engine
+   */
+  void fetch(MatlabEngine &src) noexcept
+  {
+    try
+    {
+      val_.reset(src.getVariable(src_name_));
+    }
+    catch (std::exception &e)
+    {
+      fail(e.what());
+    }
+  }
+
+  MatlabEngine &destination() { return *dst_; }
+
+protected:
+  void execute() override
+  {
+    dst_->putVariable(dst_name_, val_.get());
+    val_.reset();
+  }
+
+private:
+  std::shared_ptr<MatlabEngine> dst_; // keeps the destination worker alive
+  std::string src_name_;
+  std::string dst_name_;
+  managedMxArray val_;
+};
+} // namespace
+
+napi_value MatlabEngineJS::dispatch(napi_env env, NapiAsyncTask *task)
+{
+  std::unique_ptr<NapiAsyncTask> guard(task);
+  napi_value promise = task->promise();
+  tasks_->begin(env, task);
+  guard.release();
+
+  // run on the engine's worker thread then settle the promise on this thread
+  std::shared_ptr<NapiTaskDispatcher> tasks = tasks_;
+  eng().post([task, tasks]() {
+    task->run();
+    tasks->complete(task);
+  });
+
+  return promise;
+}
+
+napi_value MatlabEngineJS::eval_async(napi_env env, napi_value jsexpr, napi_value jsopts)
+{
+  napi_value jsthis;
+  if (napi_get_reference_value(env, wrapper_, &jsthis) != napi_ok)
+    throw std::runtime_error("Failed to get MatlabEngine object.");
+
+  // time limit & cancellation
+  napi_value jssignal = napi_get_option(env, jsopts, "signal");
+  uint32_t timeout = napi_get_option_uint32(env, jsopts, "timeout", 0);
+  std::shared_ptr<MatlabCallControl> ctl;
+  if (timeout || jssignal)
+    ctl = std::make_shared<MatlabCallControl>(std::chrono::milliseconds(timeout));
+
+  // emit output only if someone listens
+  napi_value emitter = has_listeners(env, jsthis, "output") ? jsthis : nullptr;
+  std::string expr = napi_get_value_string_utf8(env, jsexpr);
+  MatlabEngine &engine = eng();
+  if (emitter || bufena_ || ctl)
+    return dispatch(env, new EvalTask(env, engine, std::move(expr), bufsz_, bufena_ ? buf_ : nullptr, emitter, ctl, jssignal));
+
+  // output is not wanted: let the engine merge it with the evaluations queued next to it
+  std::unique_ptr<QuietEvalTask> guard(new QuietEvalTask(env));
+  napi_value promise = guard->promise();
+  tasks_->begin(env, guard.get());
+  QuietEvalTask *task = guard.release();
+
+  std::shared_ptr<NapiTaskDispatcher> tasks = tasks_;
+  engine.postEval(std::move(expr), [task, tasks](const std::string &error) {
+    task->done(error);
+    task->run();
+    tasks->complete(task);
+  });
+  return promise;
+}
+
+napi_value MatlabEngineJS::feval(napi_env env, const std::vector<napi_value> &argv)
+{
+  std::string name;
+  int nargout;
+  managedMxArray args(nullptr, mxDestroyArray);
+  feval_args(env, argv, name, nargout, args);
+
+  managedMxArray outs(eng().feval(name, nargout, args.get()), mxDestroyArray);
+  return feval_outputs(env, outs.get());
+}
+
+napi_value MatlabEngineJS::feval_async(napi_env env, const std::vector<napi_value> &argv)
+{
+  return dispatch(env, new FevalTask(env, eng(), argv));
+}
+
+napi_value MatlabEngineJS::transfer_to(napi_env env, napi_value jsdst, napi_value jssrcname, napi_value jsdstname)
+{
+  MatlabEngineJS *dst = Unwrap(env, jsdst);
+  dst->eng(); // throws if detached
+
+  std::string src_name = napi_get_value_string_utf8(env, jssrcname);
+  std::string dst_name = jsdstname ? napi_get_value_string_utf8(env, jsdstname) : src_name;
+
+  std::unique_ptr<TransferTask> guard(new TransferTask(env, dst->eng_, std::move(src_name), std::move(dst_name)));
+  napi_value promise = guard->promise();
+  tasks_->begin(env, guard.get());
+  TransferTask *task = guard.release();
+
+  // fetch on this engine's worker thread, then hand the mxArray over to the destination's
+  MatlabEngine *src = &eng();
+  std::shared_ptr<NapiTaskDispatcher> tasks = tasks_;
+  src->post([task, tasks, src]() {
+    task->fetch(*src);
+    if (task->failed())
+    {
+      tasks->complete(task);
+      return;
+    }
+
+    task->destination().post([task, tasks]() {
+      task->run();
+      tasks->complete(task);
+    });
+  });
+
+  return promise;
+}
+
+namespace
+{
+/**
+ * \brief Options of the variable retrieval
+ */
+struct GetVariableOptions
+{
+  MxArrayToNapiOptions conv; // conversion options
+  bool handle = false;       // true to return MxArray objects
+
+  GetVariableOptions(napi_env env, napi_value jsopts)
+      : conv(napi_get_mxarray_options(env, jsopts)),
+        handle(napi_get_option_bool(env, jsopts, "handle", false)) {}
+};
+
+/**
+ * \brief Convert a retrieved variable to JavaScript value (takes the ownership of array)
+ */
+napi_value variable_to_value(napi_env env, mxArray *array, const GetVariableOptions &getopts)
+{
+  managedMxArray val(array, mxDestroyArray);
+
+  // keep the array in native heap as MxArray object
+  if (getopts.handle)
+    return MatlabMxArray::NewInstance(env, val.release());
+
+  MxArrayToNapiOptions opts(getopts.conv);
+  if (!opts.copy) // typed arrays keep the fetched array alive
+    opts.owner.reset(val.release(), mxDestroyArray);
+
+  // convert mxArray to napi_value
+  return mxArrayToNapiValue(env, opts.owner ? opts.owner.get() : val.get(), opts);
+}
+
+/**
+ * \brief Convert a JavaScript value to a variable to put
+ * 
+ * MxArray object is sent as is.
+ */
+std::shared_ptr<const mxArray> value_to_variable(napi_env env, napi_value value)
+{
+  if (auto array = MatlabMxArray::Unwrap(env, value))
+    return array;
+
+  return std::shared_ptr<const mxArray>(napiValueToMxArray(env, value), mxDestroyArray);
+}
+
+/**
+ * \brief Get the variable names from a JavaScript array of strings
+ */
+std::vector<std::string> variable_names(napi_env env, napi_value jsnames)
+{
+  uint32_t n;
+  if (napi_get_array_length(env, jsnames, &n) != napi_ok)
+    throw std::runtime_error("Variable names must be given as an array.");
+
+  std::vector<std::string> names;
+  names.reserve(n);
+  for (uint32_t i = 0; i < n; ++i)
+  {
+    napi_value name;
+    if (napi_get_element(env, jsnames, i, &name) != napi_ok)
+      throw std::runtime_error("Failed to get an element of the variable name array.");
+    names.push_back(napi_get_value_string_utf8(env, name));
+  }
+  return names;
+}
+
+/**
+ * \brief Convert retrieved variables to a JavaScript object (takes the ownership of arrays)
+ */
+napi_value variables_to_object(napi_env env, const std::vector<std::string> &names, std::vector<mxArray *> &arrays,
+                               const GetVariableOptions &getopts)
+{
+  napi_value rval;
+  if (napi_create_object(env, &rval) != napi_ok)
+    throw std::runtime_error("Failed to create JavaScript object.");
+
+  for (size_t i = 0; i < names.size(); ++i)
+  {
+    mxArray *array = arrays[i];
+    arrays[i] = nullptr;
+    if (napi_set_named_property(env, rval, names[i].c_str(), variable_to_value(env, array, getopts)) != napi_ok)
+      throw std::runtime_error("Failed to set a property of the JavaScript object.");
+  }
+  return rval;
+}
+
+/**
+ * \brief Convert a JavaScript object to the variables to put
+ */
+void object_to_variables(napi_env env, napi_value jsvars, std::vector<std::string> &names, std::vector<std::shared_ptr<const mxArray>> &arrays)
+{
+  napi_value jsnames;
+  if (napi_get_property_names(env, jsvars, &jsnames) != napi_ok)
+    throw std::runtime_error("Variables must be given as an object.");
+
+  names = variable_names(env, jsnames);
+  arrays.reserve(names.size());
+  for (auto &name : names)
+  {
+    napi_value value;
+    if (napi_get_named_property(env, jsvars, name.c_str(), &value) != napi_ok)
+      throw std::runtime_error("Failed to get a property of the JavaScript object.");
+    arrays.push_back(value_to_variable(env, value));
+  }
+}
+
+std::vector<std::pair<std::string, const mxArray *>> name_value_pairs(const std::vector<std::string> &names,
+                                                                      const std::vector<std::shared_ptr<const mxArray>> &arrays)
+{
+  std::vector<std::pair<std::string, const mxArray *>> vars;
+  vars.reserve(names.size());
+  for (size_t i = 0; i < names.size(); ++i)
+    vars.emplace_back(names[i], arrays[i].get());
+  return vars;
+}
+
+/**
+ * \brief Asynchronous retrieval of multiple variables
+ */
+class GetVariablesTask : public NapiAsyncTask
+{
+public:
+  /**
+   * \param[in] single True to resolve with the value of the only variable instead of an object
+   */
+  GetVariablesTask(napi_env env, MatlabEngine &eng, std::vector<std::string> &&names, const GetVariableOptions &getopts,
+                   const bool single = false)
+      : NapiAsyncTask(env), eng_(eng), names_(std::move(names)), getopts_(getopts), single_(single) {}
+
+  ~GetVariablesTask()
+  {
+    for (auto *array : arrays_) // not converted
+      if (array)
+        mxDestroyArray(array);
+  }
+
+protected:
+  void execute() override
+  {
+    arrays_ = eng_.getVariables(names_);
+
+    // fill the large typed arrays here so that complete() only wraps them
+    if (!getopts_.handle)
+    {
+      auto buffers = std::make_shared<MxArrayBuffers>();
+      for (auto *array : arrays_)
+        if (array)
+          prepare_mxarray_buffers(array, getopts_.conv, *buffers);
+      getopts_.conv.buffers = buffers;
+    }
+  }
+
+  napi_value complete(napi_env env) override
+  {
+    if (!single_)
+      return variables_to_object(env, names_, arrays_, getopts_);
+
+    mxArray *array = arrays_[0];
+    arrays_[0] = nullptr;
+    return variable_to_value(env, array, getopts_);
+  }
+
+private:
+  MatlabEngine &eng_;
+  std::vector<std::string> names_;
+  GetVariableOptions getopts_;
+  bool single_;
+  std::vector<mxArray *> arrays_;
+};
+
+/**
+ * \brief Asynchronous assignment of multiple variables
+ */
+class PutVariablesTask : public NapiAsyncTask
+{
+public:
+  /**
+   * Values are converted here on the JavaScript thread. If deferred, the large typed arrays in 
+   * SharedArrayBuffers are only allocated here and filled by execute(), and they are kept alive
+   * until the task settles. Other buffers may be detached meanwhile, so they are always copied.
+   */
+  PutVariablesTask(napi_env env, MatlabEngine &eng, napi_value jsvars, const bool defer)
+      : NapiAsyncTask(env), eng_(eng)
+  {
+    napi_value jsnames;
+    if (napi_get_property_names(env, jsvars, &jsnames) != napi_ok)
+      throw std::runtime_error("Variables must be given as an object.");
+
+    names_ = variable_names(env, jsnames);
+    arrays_.reserve(names_.size());
+    try
+    {
+      for (auto &name : names_)
+      {
+        napi_value value;
+        if (napi_get_named_property(env, jsvars, name.c_str(), &value) != napi_ok)
+          throw std::runtime_error("Failed to get a property of the JavaScript object.");
+        convert(env, value, defer);
+      }
+    }
+    catch (...)
+    {
+      cleanup(env); // release the references taken so far
+      throw;
+    }
+  }
+
+  PutVariablesTask(napi_env env, MatlabEngine &eng, napi_value jsname, napi_value jsvalue, const bool defer)
+      : NapiAsyncTask(env), eng_(eng)
+  {
+    names_.push_back(napi_get_value_string_utf8(env, jsname));
+    convert(env, jsvalue, defer);
+  }
+
+protected:
+  void execute() override
+  {
+    for (auto &fill : fills_)
+      std::copy_n(reinterpret_cast<const uint8_t *>(fill.src), fill.bytes, reinterpret_cast<uint8_t *>(mxGetData(fill.dst)));
+    eng_.putVariables(name_value_pairs(names_, arrays_));
+    arrays_.clear();
+  }
+
+  void cleanup(napi_env env) override
+  {
+    arrays_.clear();
+    fills_.clear();
+    for (napi_ref ref : refs_)
+      napi_delete_reference(env, ref);
+    refs_.clear();
+  }
+
+private:
+  /**
+   * \brief Convert a value, deferring the copy of a large shared typed array if allowed
+   */
+  void convert(napi_env env, napi_value value, const bool defer)
+  {
+    bool is_typedarray;
+    napi_value data;
+    if (defer && napi_is_typedarray(env, value, &is_typedarray) == napi_ok &&
+        (is_typedarray || is_shaped_typedarray(env, value, data)))
+    {
+      napi_value typedarray = is_typedarray ? value : data;
+      Fill fill;
+      managedMxArray array = create_for_shared_typedarray(env, typedarray, value, fill.src, fill.bytes);
+      if (array)
+      {
+        napi_ref ref;
+        if (napi_create_reference(env, typedarray, 1, &ref) != napi_ok)
+          throw std::runtime_error("Failed to create a reference to a typed array.");
+        refs_.push_back(ref);
+        fill.dst = array.get();
+        fills_.push_back(fill);
+        arrays_.emplace_back(array.release(), mxDestroyArray);
+        return;
+      }
+    }
+    arrays_.push_back(value_to_variable(env, value));
+  }
+
+  struct Fill
+  {
+    mxArray *dst;
+    const void *src;
+    size_t bytes;
+  };
+
+  MatlabEngine &eng_;
+  std::vector<std::string> names_;
+  std::vector<std::shared_ptr<const mxArray>> arrays_;
+  std::vector<Fill> fills_;    // deferred copies
+  std::vector<napi_ref> refs_; // their shared typed arrays
+};
+} // namespace
+
+napi_value MatlabEngineJS::get_variable(napi_env env, napi_value jsname, napi_value jsopts)
+{
+  // get the variable from MATLAB
+  mxArray *array = eng().getVariable(napi_get_value_string_utf8(env, jsname).c_str());
+  if (!array)
+    throw std::runtime_error("Failed to retrieve the requested Matlab variable.");
+
+  return variable_to_value(env, array, GetVariableOptions(env, jsopts));
+}
+
+void MatlabEngineJS::put_variable(napi_env env, napi_value jsname, napi_value jsvalue, napi_value /*jsopts*/)
+{
   // variable name
   std::string var_name = napi_get_value_string_utf8(env, jsname);
-  
+
   // convert to mxArray
-  managedMxArray val(napiValueToMxArray(env, jsvalue), mxDestroyArray);
+  auto val = value_to_variable(env, jsvalue);
 
-  // get the variable from MATLAB
-  eng_.putVariable(var_name.c_str(), val.get());
+  // put the variable to MATLAB
+  eng().putVariable(var_name.c_str(), val.get());
+}
+
+napi_value MatlabEngineJS::get_variable_async(napi_env env, napi_value jsname, napi_value jsopts)
+{
+  GetVariableOptions getopts(env, jsopts);
+  std::vector<std::string> names{napi_get_value_string_utf8(env, jsname)};
+  return dispatch(env, new GetVariablesTask(env, eng(), std::move(names), getopts, true));
+}
+
+napi_value MatlabEngineJS::put_variable_async(napi_env env, napi_value jsname, napi_value jsvalue, napi_value jsopts)
+{
+  bool defer = !napi_get_option_bool(env, jsopts, "copy", true);
+  return dispatch(env, new PutVariablesTask(env, eng(), jsname, jsvalue, defer));
+}
+
+napi_value MatlabEngineJS::get_variables(napi_env env, napi_value jsnames, napi_value jsopts)
+{
+  GetVariableOptions getopts(env, jsopts);
+  std::vector<std::string> names = variable_names(env, jsnames);
+  std::vector<mxArray *> arrays = eng().getVariables(names);
+  try
+  {
+    return variables_to_object(env, names, arrays, getopts);
+  }
+  catch (...)
+  {
+    for (auto *array : arrays) // not converted
+      if (array)
+        mxDestroyArray(array);
+    throw;
+  }
+}
+
+napi_value MatlabEngineJS::get_variables_async(napi_env env, napi_value jsnames, napi_value jsopts)
+{
+  GetVariableOptions getopts(env, jsopts);
+  return dispatch(env, new GetVariablesTask(env, eng(), variable_names(env, jsnames), getopts));
+}
+
+void MatlabEngineJS::put_variables(napi_env env, napi_value jsvars, napi_value /*jsopts*/)
+{
+  std::vector<std::string> names;
+  std::vector<std::shared_ptr<const mxArray>> arrays;
+  object_to_variables(env, jsvars, names, arrays);
+
+  eng().putVariables(name_value_pairs(names, arrays));
+}
+
+napi_value MatlabEngineJS::put_variables_async(napi_env env, napi_value jsvars, napi_value jsopts)
+{
+  bool defer = !napi_get_option_bool(env, jsopts, "copy", true);
+  return dispatch(env, new PutVariablesTask(env, eng(), jsvars, defer));
 }
@@ -7,13 +7,18 @@
 
 #pragma once
 
+#include "matlab-addon-data.h"
 #include "matlab-engine.h"
+#include "napi_async_utils.h"
 // #include "matlab-mxarray.h"
 
 #include <node_api.h>
 
+#include <functional>
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 /**
  * MatlabEngineJS   Interface between JS and Matlab
@@ -28,8 +33,12 @@
  * Eval   - Asynchronous Matlab expression evaluation
  * PutVariable - Place given variable onto Matlab workspace
  * GetVariable - Get specified variable from Matlab workspace
+ * PutVariableAsync/GetVariableAsync - Asynchronous PutVariable/GetVariable
+ * PutVariables/PutVariablesSync - Place given variables onto Matlab workspace at once
+ * GetVariables/GetVariablesSync - Get specified variables from Matlab workspace at once
  * FevalSync - Synchronous m-function evaluation
  * Feval  - Asynchronous m-function evaluation
+ * TransferTo - Asynchronously copy a variable to another Matlab session
  * ******* PROTOTYPE VARIABLES ******
  * IsOpen - returns True if Matalb session is open
  * Visible     - true if visible (setVisible, getVisible)
@@ -44,7 +53,46 @@ public:
 
   static void Destructor(napi_env env, void *nativeObject, void *finalize_hint);
 
-  static napi_ref constructor;
+  /**
+ * \brief Environment cleanup hook: stops the engine from calling back into an environment being torn down
+ */
+  static void Cleanup(void *arg);
+
+  /**
+ * \brief Reference to the Engine class of the environment
+ */
+  static napi_ref &constructor(napi_env env) { return MatlabAddonData::Get(env).engine_constructor; }
+
+  /**
+ * \brief Create a new JavaScript MatlabEngine object sharing an existing engine
+ */
+  static napi_value NewInstance(napi_env env, std::shared_ptr<MatlabEngine> engine);
+
+  /**
+ * \brief Get the native object of a JavaScript MatlabEngine object
+ * 
+ * \throws std::runtime_error if value is not a MatlabEngine object
+ */
+  static MatlabEngineJS *Unwrap(napi_env env, napi_value value);
+
+  /**
+ * \brief The engine used by this object (null if detached)
+ */
+  const std::shared_ptr<MatlabEngine> &engine() const { return eng_; }
+
+  /**
+ * \brief Stop using the engine. Subsequent calls fail.
+ * 
+ * \returns the detached engine
+ */
+  std::shared_ptr<MatlabEngine> detach();
+
+  /**
+ * \brief Set the function to call if the object is garbage collected without being detached
+ * 
+ * Called from the finalizer (it must not throw), e.g., to return a leased engine to its pool.
+ */
+  void on_finalize(std::function<void(napi_env)> fn) { on_finalize_ = std::move(fn); }
 
 private:
   /**
@@ -81,32 +129,32 @@ private:
   /**
  * \brief Asynchronously run MATLAB m-function
  * 
- * plhs_promise = session.Feval(nlhs, prhs)
+ * plhs_promise = session.Feval(name, nlhs, ...prhs)
  * 
  */
-  // static napi_value Feval(napi_env env, napi_callback_info info);
+  static napi_value Feval(napi_env env, napi_callback_info info);
 
   /**
  * \brief Asynchronously evluates MATLAB expression
  * 
- * session.Eval(expr)
+ * session.Eval(expr[, options])
  * output_promise = session.Eval(expr) - to retrieve output buffer
  * 
  */
-  // static napi_value Eval(napi_env env, napi_callback_info info);
+  static napi_value Eval(napi_env env, napi_callback_info info);
 
   /**
  * \brief Synchronously run MATLAB m-function
  * 
- * plhs = session.FevalSync(nlhs, prhs)
+ * plhs = session.FevalSync(name, nlhs, ...prhs)
  * 
  */
-  // static napi_value FevalSync(napi_env env, napi_callback_info info);
+  static napi_value FevalSync(napi_env env, napi_callback_info info);
 
   /**
  * \brief Synchronously evluates MATLAB expression
  * 
- * session.EvalSync(expr)
+ * session.EvalSync(expr[, options])
  * output = session.EvalSync(expr) - to retrieve output buffer
  * 
  */
@@ -115,16 +163,65 @@ private:
   /**
  * \brief Copy variable from MATLAB engine workspace
  * 
- * value = session.GetVariable(name)
+ * value = session.GetVariable(name[, options])
  */
   static napi_value GetVariable(napi_env env, napi_callback_info info);
 
   /**
  * \brief Put variable into MATLAB engine workspace
- * session.PutVariable(name, value)
+ * session.PutVariable(name, value[, options])
  */
   static napi_value PutVariable(napi_env env, napi_callback_info info);
 
+  /**
+ * \brief Asynchronously copy variable from MATLAB engine workspace
+ * 
+ * value_promise = session.getVariableAsync(name[, options])
+ */
+  static napi_value GetVariableAsync(napi_env env, napi_callback_info info);
+
+  /**
+ * \brief Asynchronously put variable into MATLAB engine workspace
+ * 
+ * done_promise = session.putVariableAsync(name, value[, options])
+ */
+  static napi_value PutVariableAsync(napi_env env, napi_callback_info info);
+
+  /**
+ * \brief Asynchronously copy variables from MATLAB engine workspace
+ * 
+ * values_promise = session.GetVariables(names[, options])
+ */
+  static napi_value GetVariables(napi_env env, napi_callback_info info);
+
+  /**
+ * \brief Synchronously copy variables from MATLAB engine workspace
+ * 
+ * values = session.GetVariablesSync(names[, options])
+ */
+  static napi_value GetVariablesSync(napi_env env, napi_callback_info info);
+
+  /**
+ * \brief Asynchronously put variables into MATLAB engine workspace
+ * 
+ * done_promise = session.PutVariables(values[, options])
+ */
+  static napi_value PutVariables(napi_env env, napi_callback_info info);
+
+  /**
+ * \brief Synchronously put variables into MATLAB engine workspace
+ * 
+ * session.PutVariablesSync(values[, options])
+ */
+  static napi_value PutVariablesSync(napi_env env, napi_callback_info info);
+
+  /**
+ * \brief Copy variable to another MATLAB engine workspace without JavaScript conversion
+ * 
+ * done_promise = session.TransferTo(dst_session, src_name[, dst_name])
+ */
+  static napi_value TransferTo(napi_env env, napi_callback_info info);
+
   /**
  * \brief Getter for session.Visible property
  */
@@ -189,18 +286,58 @@ private:
   void set_buffer_size(napi_env env, napi_value value);
   napi_value get_buffer(napi_env env);
 
-  napi_value eval(napi_env env, napi_value jsexpr);
+  napi_value eval(napi_env env, napi_value jsexpr, napi_value jsopts = nullptr);
+  napi_value eval_async(napi_env env, napi_value jsexpr, napi_value jsopts = nullptr);
+
+  napi_value feval(napi_env env, const std::vector<napi_value> &argv);
+  napi_value feval_async(napi_env env, const std::vector<napi_value> &argv);
+
+  napi_value get_variable(napi_env env, napi_value jsname, napi_value jsopts = nullptr);
+  napi_value get_variable_async(napi_env env, napi_value jsname, napi_value jsopts = nullptr);
+
+  void put_variable(napi_env env, napi_value jsname, napi_value jsvalue, napi_value jsopts = nullptr);
+  napi_value put_variable_async(napi_env env, napi_value jsname, napi_value jsvalue, napi_value jsopts = nullptr);
 
-  napi_value get_variable(napi_env env, napi_value jsname);
+  napi_value get_variables(napi_env env, napi_value jsnames, napi_value jsopts = nullptr);
+  napi_value get_variables_async(napi_env env, napi_value jsnames, napi_value jsopts = nullptr);
 
-  void put_variable(napi_env env, napi_value jsname, napi_value jsvalue);
+  void put_variables(napi_env env, napi_value jsvars, napi_value jsopts = nullptr);
+  napi_value put_variables_async(napi_env env, napi_value jsvars, napi_value jsopts = nullptr);
+
+  napi_value transfer_to(napi_env env, napi_value jsdst, napi_value jssrcname, napi_value jsdstname = nullptr);
 
   /**
- * \brief Put variable into MATLAB engine workspace
+ * \brief Post a task to the engine's worker thread
+ * 
+ * \returns the task's promise
+ */
+  napi_value dispatch(napi_env env, NapiAsyncTask *task);
+
+  /**
+ * \brief Get the shared engine started with the given command, creating it if there is none
  */
-  // void put_variable(napi_env env, const std::string &name, MatlabMxArray &array);
+  static std::shared_ptr<MatlabEngine> shared_engine(const std::string &startcmd);
 
-  MatlabEngine eng_;
+  /**
+ * \brief The engine in use
+ * 
+ * \throws std::runtime_error if the engine has been detached
+ */
+  MatlabEngine &eng();
 
   napi_ref wrapper_;
+  bool cleanup_hooked_; // Cleanup() is registered with the environment
+
+  // shared with the queued calls, which may outlive this object
+  std::shared_ptr<NapiTaskDispatcher> tasks_; // settles asynchronous calls
+
+  std::shared_ptr<MatlabEngine> eng_; // may be shared with an engine pool or other Engine objects
+  bool shared_;                       // eng_ is from shared_engine()
+  std::string startcmd_;              // to reacquire a shared engine after close()
+  std::function<void(napi_env)> on_finalize_; // see on_finalize()
+
+  // output buffer of this object, kept here as eng_ may be shared
+  bool bufena_;                      // eval() returns its output
+  size_t bufsz_;                     // maximum number of characters of output eval() returns
+  std::shared_ptr<std::string> buf_; // output of the last eval() (shared with the pending EvalTasks)
 };
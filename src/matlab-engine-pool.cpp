@@ -0,0 +1,510 @@
+#include "matlab-engine-pool.h"
+#include "matlab-engine-js.h"
+#include "napi_utils.h"
+
+#include <stdexcept>
+#include <string>
+
+
+// macro to create napi_property_descriptor initializer list
+#define DECLARE_NAPI_METHOD(name, func)     \
+  {                                         \
+    name, 0, func, 0, 0, 0, napi_default, 0 \
+  }
+
+napi_value MatlabEnginePool::Init(napi_env env, napi_value exports)
+{
+  // define all the class (static) member functions as node.js array
+  napi_property_descriptor properties[] = {
+      DECLARE_NAPI_METHOD("acquire", MatlabEnginePool::Acquire),
+      DECLARE_NAPI_METHOD("release", MatlabEnginePool::Release),
+      DECLARE_NAPI_METHOD("close", MatlabEnginePool::Close),
+      {"size", 0, 0, MatlabEnginePool::GetSize, 0, 0, napi_default, nullptr},
+      {"available", 0, 0, MatlabEnginePool::GetAvailable, 0, 0, napi_default, nullptr}};
+
+  //define NodeJS class
+  napi_value cons;
+  if (napi_define_class(env, "EnginePool", NAPI_AUTO_LENGTH, MatlabEnginePool::Create,
+                        nullptr, dim(properties), properties, &cons) != napi_ok)
+    napi_fatal_error("MatlabEnginePool::Init", NAPI_AUTO_LENGTH, "Failed to define EnginePool class.", NAPI_AUTO_LENGTH);
+
+  if (napi_create_reference(env, cons, 1, &constructor(env)) != napi_ok)
+    napi_fatal_error("MatlabEnginePool::Init", NAPI_AUTO_LENGTH, "Failed to create EnginePool class reference.", NAPI_AUTO_LENGTH);
+
+  if (napi_set_named_property(env, exports, "EnginePool", cons) != napi_ok)
+    napi_fatal_error("MatlabEnginePool::Init", NAPI_AUTO_LENGTH, "Failed to add EnginePool class constructor to the exported object.", NAPI_AUTO_LENGTH);
+
+  return exports;
+}
+
+// create new instance of the class
+//   new Matlab.EnginePool(size,[options])
+//      options <Object>
+//         resetCommand <string> Default: 'clear all'
+//         startCommand <string> Command to start MATLAB (UNIX). Default: '' (local matlab)
+napi_value MatlabEnginePool::Create(napi_env env, napi_callback_info info)
+{
+  try
+  {
+    // retrieve details about the call
+    auto prhs = napi_get_cb_info<MatlabEnginePool>(env, info, 1, 2);
+
+    napi_value target;
+    if (napi_get_new_target(env, info, &target) != napi_ok)
+      napi_fatal_error("MatlabEnginePool::Create", NAPI_AUTO_LENGTH, "Failed to call napi_get_new_target().", NAPI_AUTO_LENGTH);
+
+    if (target) // Invoked as constructor: `new EnginePool(...)`
+    {
+      new MatlabEnginePool(env, prhs.jsthis, value2uint32(env, prhs.argv[0]),
+                           prhs.argv.size() > 1 ? prhs.argv[1] : nullptr);
+      return prhs.jsthis;
+    }
+    else // Invoked as plain function `EnginePool(...)`, turn into construct call.
+    {
+      napi_value cons;
+      if (napi_get_reference_value(env, constructor(env), &cons) != napi_ok)
+        napi_fatal_error("MatlabEnginePool::Create", NAPI_AUTO_LENGTH, "Failed to call napi_get_reference_value().", NAPI_AUTO_LENGTH);
+
+      // call this function again but invoked as constructor
+      napi_value instance;
+      if (napi_new_instance(env, cons, prhs.argv.size(), prhs.argv.data(), &instance) != napi_ok)
+        return nullptr;
+
+      return instance;
+    }
+  }
+  catch (std::exception &e)
+  {
+    napi_throw_error(env, "", e.what());
+    return nullptr;
+  }
+}
+
+void MatlabEnginePool::Destructor(napi_env env, void *nativeObject, void * /*finalize_hint*/)
+{
+  MatlabEnginePool *obj = reinterpret_cast<MatlabEnginePool *>(nativeObject);
+
+  if (obj->cleanup_hooked_)
+    napi_remove_env_cleanup_hook(env, MatlabEnginePool::Cleanup, obj);
+
+  // release the instance from node.js
+  if (obj->wrapper_)
+    napi_delete_reference(env, obj->wrapper_);
+
+  // delete the object
+  delete obj;
+}
+
+void MatlabEnginePool::Cleanup(void *arg)
+{
+  MatlabEnginePool *obj = reinterpret_cast<MatlabEnginePool *>(arg);
+  obj->cleanup_hooked_ = false;
+  obj->self_.reset(); // the sessions collected from now on do not come back
+
+  obj->close();
+
+  // the engines still starting are kept by their start-up tasks, whose outcomes are discarded from
+  // now on (they share tasks_, so they need not be waited for). Leased engines are left to their
+  // MatlabEngine objects.
+  for (auto &slot : obj->slots_)
+  {
+    if (slot.state == SlotState::Starting)
+    {
+      slot.eng.reset();
+      slot.state = SlotState::Dead;
+    }
+  }
+
+  obj->tasks_->release();
+}
+
+napi_value MatlabEnginePool::Acquire(napi_env env, napi_callback_info info)
+{
+  try
+  { // retrieve the input arguments
+    auto prhs = napi_get_cb_info<MatlabEnginePool>(env, info, 0, 0);
+    if (!prhs.obj)
+      return nullptr;
+
+    return prhs.obj->acquire(env);
+  }
+  catch (std::exception &e)
+  {
+    napi_throw_error(env, "", e.what());
+    return nullptr;
+  }
+}
+
+napi_value MatlabEnginePool::Release(napi_env env, napi_callback_info info)
+{
+  try
+  { // retrieve the input arguments
+    auto prhs = napi_get_cb_info<MatlabEnginePool>(env, info, 1, 1);
+    if (!prhs.obj)
+      return nullptr;
+
+    prhs.obj->release(env, prhs.argv[0]);
+  }
+  catch (std::exception &e)
+  {
+    napi_throw_error(env, "", e.what());
+  }
+  return nullptr;
+}
+
+napi_value MatlabEnginePool::Close(napi_env env, napi_callback_info info)
+{
+  try
+  { // retrieve the input arguments
+    auto prhs = napi_get_cb_info<MatlabEnginePool>(env, info, 0, 0);
+    if (!prhs.obj)
+      return nullptr;
+
+    // reject everyone still waiting
+    napi_value msg, err;
+    napi_create_string_utf8(env, "Engine pool has been closed.", NAPI_AUTO_LENGTH, &msg);
+    napi_create_error(env, nullptr, msg, &err);
+    for (napi_deferred deferred : prhs.obj->waiters_)
+      napi_reject_deferred(env, deferred, err);
+    prhs.obj->waiters_.clear();
+
+    prhs.obj->close();
+  }
+  catch (std::exception &e)
+  {
+    napi_throw_error(env, "", e.what());
+  }
+  return nullptr;
+}
+
+napi_value MatlabEnginePool::GetSize(napi_env env, napi_callback_info info)
+{
+  try
+  { // retrieve the input arguments
+    auto prhs = napi_get_cb_info<MatlabEnginePool>(env, info, 0, 0);
+    if (!prhs.obj)
+      return nullptr;
+
+    napi_value rval;
+    if (napi_create_uint32(env, (uint32_t)prhs.obj->slots_.size(), &rval) != napi_ok)
+      throw std::runtime_error("napi_create_uint32() failed.");
+    return rval;
+  }
+  catch (std::exception &e)
+  {
+    napi_throw_error(env, "", e.what());
+    return nullptr;
+  }
+}
+
+napi_value MatlabEnginePool::GetAvailable(napi_env env, napi_callback_info info)
+{
+  try
+  { // retrieve the input arguments
+    auto prhs = napi_get_cb_info<MatlabEnginePool>(env, info, 0, 0);
+    if (!prhs.obj)
+      return nullptr;
+
+    napi_value rval;
+    if (napi_create_uint32(env, (uint32_t)prhs.obj->idle_.size(), &rval) != napi_ok)
+      throw std::runtime_error("napi_create_uint32() failed.");
+    return rval;
+  }
+  catch (std::exception &e)
+  {
+    napi_throw_error(env, "", e.what());
+    return nullptr;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+napi_value make_error(napi_env env, const std::string &msg)
+{
+  napi_value str, err;
+  if (napi_create_string_utf8(env, msg.c_str(), NAPI_AUTO_LENGTH, &str) != napi_ok ||
+      napi_create_error(env, nullptr, str, &err) != napi_ok)
+    throw std::runtime_error("Failed to create JavaScript error.");
+  return err;
+}
+} // namespace
+
+/**
+ * \brief Opens or resets the engine of a pool slot on the engine's worker thread
+ */
+class MatlabEnginePool::PrepareTask : public NapiAsyncTask
+{
+public:
+  PrepareTask(napi_env env, MatlabEnginePool *pool, size_t slot, const std::string &reset_cmd)
+      : NapiAsyncTask(env, false), pool_(pool), slot_(slot), eng_(pool->slots_[slot].eng), reset_cmd_(reset_cmd) {}
+
+  ~PrepareTask() { MatlabEngine::release(eng_); } // may be on the engine's worker
+
+protected:
+  void execute() override
+  {
+    if (!eng_->alive()) // MATLAB exited: replace it
+      eng_->close();
+    else if (!reset_cmd_.empty())
+    {
+      try
+      { // engine is alive if it can reset its workspace
+        eng_->eval(reset_cmd_);
+        return;
+      }
+      catch (...)
+      { // engine died or was closed: replace it
+        eng_->close();
+      }
+    }
+    eng_->open();
+  }
+
+  napi_value complete(napi_env env) override
+  {
+    if (failed())
+      pool_->failed(env, slot_, error());
+    else
+      pool_->ready(env, slot_);
+    return nullptr;
+  }
+
+private:
+  MatlabEnginePool *pool_; // pinned by tasks_ while this task is pending
+  size_t slot_;
+  std::shared_ptr<MatlabEngine> eng_; // kept alive even if the slot lets go of it
+  std::string reset_cmd_;
+};
+
+MatlabEnginePool::MatlabEnginePool(napi_env env, napi_value jsthis, uint32_t size, napi_value opt_value)
+    : wrapper_(nullptr), cleanup_hooked_(false), tasks_(std::make_shared<NapiTaskDispatcher>()),
+      self_(std::make_shared<MatlabEnginePool *>(this)), reset_cmd_("clear all"), closed_(false)
+{
+  if (size == 0)
+    throw std::runtime_error("Engine pool size must be positive.");
+
+  // parse options
+  if (opt_value)
+  {
+    bool has_prop;
+    napi_value prop;
+    if (napi_has_named_property(env, opt_value, "resetCommand", &has_prop) == napi_ok && has_prop &&
+        napi_get_named_property(env, opt_value, "resetCommand", &prop) == napi_ok)
+      reset_cmd_ = napi_get_value_string_utf8(env, prop);
+    if (napi_has_named_property(env, opt_value, "startCommand", &has_prop) == napi_ok && has_prop &&
+        napi_get_named_property(env, opt_value, "startCommand", &prop) == napi_ok)
+      start_cmd_ = napi_get_value_string_utf8(env, prop);
+  }
+
+  slots_.resize(size);
+  for (auto &slot : slots_)
+    slot.eng = std::make_shared<MatlabEngine>(true, start_cmd_);
+
+  // Wraps the new native instance in a JavaScript object (last, see MatlabEngineJS)
+  if (napi_create_reference(env, jsthis, 0, &wrapper_) != napi_ok)
+    throw std::runtime_error("Failed to reference the EnginePool object.");
+  try
+  {
+    // prepare to receive the outcomes of engine start-ups and resets
+    tasks_->init(env, wrapper_, "MatlabEnginePool");
+    if (napi_wrap(env, jsthis, this, MatlabEnginePool::Destructor, nullptr, nullptr) != napi_ok)
+      throw std::runtime_error("Failed to wrap the EnginePool object.");
+  }
+  catch (...)
+  {
+    tasks_->release();
+    napi_delete_reference(env, wrapper_);
+    wrapper_ = nullptr;
+    throw;
+  }
+  cleanup_hooked_ = napi_add_env_cleanup_hook(env, MatlabEnginePool::Cleanup, this) == napi_ok;
+
+  // start all the engines in parallel, each on its own worker thread
+  for (size_t i = 0; i < size; ++i)
+    start(env, i, false);
+}
+
+MatlabEnginePool::~MatlabEnginePool()
+{
+  self_.reset();
+  close();
+}
+
+void MatlabEnginePool::start(napi_env env, size_t slot, bool reset)
+{
+  slots_[slot].state = SlotState::Starting;
+
+  PrepareTask *task = new PrepareTask(env, this, slot, reset ? reset_cmd_ : std::string());
+  tasks_->begin(env, task);
+
+  std::shared_ptr<NapiTaskDispatcher> tasks = tasks_;
+  slots_[slot].eng->post([task, tasks]() {
+    task->run();
+    tasks->complete(task);
+  });
+}
+
+napi_value MatlabEnginePool::acquire(napi_env env)
+{
+  if (closed_)
+    throw std::runtime_error("Engine pool has been closed.");
+
+  napi_deferred deferred;
+  napi_value promise;
+  if (napi_create_promise(env, &deferred, &promise) != napi_ok)
+    throw std::runtime_error("Failed to create JavaScript promise.");
+
+  while (idle_.size())
+  {
+    size_t slot = idle_.front();
+    idle_.pop_front();
+    if (slots_[slot].eng->alive())
+    {
+      napi_resolve_deferred(env, deferred, lease(env, slot));
+      return promise;
+    }
+    start(env, slot, false); // MATLAB exited while idle: replace it
+  }
+
+  waiters_.push_back(deferred);
+
+  // replace the engines which failed earlier
+  for (size_t i = 0; i < slots_.size(); ++i)
+    if (slots_[i].state == SlotState::Dead)
+      start(env, i, false);
+
+  return promise;
+}
+
+napi_value MatlabEnginePool::lease(napi_env env, size_t slot)
+{
+  napi_value session = MatlabEngineJS::NewInstance(env, slots_[slot].eng);
+  slots_[slot].state = SlotState::Leased;
+
+  // take the slot back if the session is garbage collected without release()
+  std::weak_ptr<MatlabEnginePool *> pool(self_);
+  std::weak_ptr<MatlabEngine> engine(slots_[slot].eng);
+  MatlabEngineJS::Unwrap(env, session)->on_finalize([pool, engine](napi_env env) {
+    auto self = pool.lock();
+    auto eng = engine.lock();
+    if (!self || !eng)
+      return;
+    try
+    {
+      size_t slot = (*self)->leased_slot(eng);
+      if (slot < (*self)->slots_.size())
+        (*self)->recycle(env, slot);
+    }
+    catch (...)
+    {
+    }
+  });
+  return session;
+}
+
+size_t MatlabEnginePool::leased_slot(const std::shared_ptr<MatlabEngine> &eng) const
+{
+  size_t slot = 0;
+  while (slot < slots_.size() && !(slots_[slot].state == SlotState::Leased && slots_[slot].eng == eng))
+    ++slot;
+  return slot;
+}
+
+void MatlabEnginePool::release(napi_env env, napi_value session)
+{
+  MatlabEngineJS *obj = MatlabEngineJS::Unwrap(env, session);
+
+  size_t slot = leased_slot(obj->engine());
+  if (slot == slots_.size())
+    throw std::runtime_error("Session is not leased from this engine pool.");
+
+  // the session object can no longer be used
+  obj->detach();
+  recycle(env, slot);
+}
+
+void MatlabEnginePool::recycle(napi_env env, size_t slot)
+{
+  if (closed_) // let the engine go
+    drop(slot);
+  else // reset its workspace (queued after the session's pending calls)
+    start(env, slot, true);
+}
+
+void MatlabEnginePool::close()
+{
+  closed_ = true;
+  idle_.clear();
+
+  // let the engines close in parallel on their worker threads
+  for (auto &slot : slots_)
+  {
+    if (slot.eng && (slot.state == SlotState::Idle || slot.state == SlotState::Dead))
+      slot.eng->post([eng = slot.eng.get()]() { eng->close(); });
+  }
+
+  // then wait for each. Starting engines are dropped once started and leased
+  // ones once released.
+  for (size_t i = 0; i < slots_.size(); ++i)
+  {
+    if (slots_[i].state == SlotState::Idle || slots_[i].state == SlotState::Dead)
+    {
+      slots_[i].eng.reset();
+      slots_[i].state = SlotState::Dead;
+    }
+  }
+}
+
+void MatlabEnginePool::drop(size_t slot)
+{
+  if (slots_[slot].eng)
+  {
+    slots_[slot].eng->post([eng = slots_[slot].eng.get()]() { eng->close(); });
+    slots_[slot].eng.reset();
+  }
+  slots_[slot].state = SlotState::Dead;
+}
+
+void MatlabEnginePool::ready(napi_env env, size_t slot)
+{
+  if (closed_)
+  {
+    drop(slot);
+    return;
+  }
+
+  if (waiters_.size())
+  {
+    napi_deferred deferred = waiters_.front();
+    waiters_.pop_front();
+    napi_resolve_deferred(env, deferred, lease(env, slot));
+  }
+  else
+  {
+    slots_[slot].state = SlotState::Idle;
+    idle_.push_back(slot);
+  }
+}
+
+void MatlabEnginePool::failed(napi_env env, size_t slot, const std::string &msg)
+{
+  if (closed_)
+  {
+    drop(slot);
+    return;
+  }
+
+  slots_[slot].state = SlotState::Dead;
+
+  // if no engine is left to wait for, fail everyone waiting
+  for (auto &s : slots_)
+    if (s.state != SlotState::Dead)
+      return;
+
+  napi_value err = make_error(env, msg);
+  for (napi_deferred deferred : waiters_)
+    napi_reject_deferred(env, deferred, err);
+  waiters_.clear();
+}
@@ -0,0 +1,172 @@
+// defines an native addon node.js object to manage a pool of pre-started MATLAB engines
+//    .acquire()
+//    .release(session)
+//    .close()
+
+#pragma once
+
+#include "matlab-addon-data.h"
+#include "matlab-engine.h"
+#include "napi_async_utils.h"
+
+#include <node_api.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * MatlabEnginePool   Pool of MATLAB engine sessions
+ *
+ * All the engines are started in parallel when the pool is created, so that
+ * acquiring a session never waits for MATLAB to start up. Released sessions
+ * get their workspace reset and dead engines are restarted before they are
+ * handed out again. A session which is garbage collected without being
+ * released returns to the pool as well.
+ *
+ * Init - export
+ * Create     - create new MatlabEnginePool object
+ * Destructor - destroy MatlabEnginePool object
+ * ****** PROTYPE FUNCTIONS ******
+ * Acquire - Lease a session (returns a promise of MatlabEngine object)
+ * Release - Return a leased session to the pool
+ * Close   - Close all the engines
+ * ******* PROTOTYPE VARIABLES ******
+ * Size      - Number of engines in the pool, read-only
+ * Available - Number of engines ready to be leased, read-only
+ */
+class MatlabEnginePool
+{
+public:
+  static napi_value Init(napi_env env, napi_value exports);
+
+  static void Destructor(napi_env env, void *nativeObject, void *finalize_hint);
+
+  /**
+ * \brief Environment cleanup hook: closes the pool without waiting for the engine start-ups in progress
+ */
+  static void Cleanup(void *arg);
+
+  /**
+ * \brief Reference to the EnginePool class of the environment
+ */
+  static napi_ref &constructor(napi_env env) { return MatlabAddonData::Get(env).pool_constructor; }
+
+private:
+  /**
+ * \brief Create new MatlabEnginePool object
+ *
+ * new EnginePool(size[, options])
+ *    options <Object>
+ *       resetCommand <string> MATLAB command to run on release. Default: 'clear all'
+ *       startCommand <string> Command to start MATLAB (UNIX). Default: '' (local matlab)
+ */
+  static napi_value Create(napi_env env, napi_callback_info info);
+
+  /**
+ * \brief Lease a session
+ *
+ * session_promise = pool.acquire()
+ */
+  static napi_value Acquire(napi_env env, napi_callback_info info);
+
+  /**
+ * \brief Return a leased session
+ *
+ * pool.release(session)
+ */
+  static napi_value Release(napi_env env, napi_callback_info info);
+
+  /**
+ * \brief Close all the engines and reject pending acquire() calls
+ *
+ * pool.close()
+ */
+  static napi_value Close(napi_env env, napi_callback_info info);
+
+  /**
+ * \brief Getter for pool.size property
+ */
+  static napi_value GetSize(napi_env env, napi_callback_info info);
+
+  /**
+ * \brief Getter for pool.available property
+ */
+  static napi_value GetAvailable(napi_env env, napi_callback_info info);
+
+  //////////////////////////////////////////////////////////////////////////////////////
+  //////////////////////////////////////////////////////////////////////////////////////
+
+  MatlabEnginePool(napi_env env, napi_value jsthis, uint32_t size, napi_value opt = nullptr);
+  ~MatlabEnginePool();
+
+  napi_value acquire(napi_env env);
+  void release(napi_env env, napi_value session);
+  void close();
+
+  /**
+   * \brief Hand the engine of a slot out as a new MatlabEngine object
+   */
+  napi_value lease(napi_env env, size_t slot);
+
+  /**
+   * \brief Index of the slot which leased out eng (slots_.size() if none)
+   */
+  size_t leased_slot(const std::shared_ptr<MatlabEngine> &eng) const;
+
+  /**
+   * \brief Reset the engine of a slot given back, or let it go if the pool is closed
+   */
+  void recycle(napi_env env, size_t slot);
+
+  /**
+   * \brief Start (or restart) the engine of a slot on its worker thread
+   */
+  void start(napi_env env, size_t slot, bool restart);
+
+  /**
+   * \brief Hand the engine of a ready slot to a waiting acquire() call or mark it idle
+   */
+  void ready(napi_env env, size_t slot);
+
+  /**
+   * \brief Called after a slot failed to (re)start its engine
+   */
+  void failed(napi_env env, size_t slot, const std::string &msg);
+
+  /**
+   * \brief Close and let go of the engine of a slot
+   */
+  void drop(size_t slot);
+
+  class PrepareTask;
+
+  enum class SlotState
+  {
+    Starting,
+    Idle,
+    Leased,
+    Dead
+  };
+
+  struct Slot
+  {
+    std::shared_ptr<MatlabEngine> eng;
+    SlotState state;
+  };
+
+  napi_ref wrapper_;
+  bool cleanup_hooked_; // Cleanup() is registered with the environment
+
+  std::shared_ptr<NapiTaskDispatcher> tasks_; // receives engine start/reset outcomes (shared with the posted calls)
+
+  std::shared_ptr<MatlabEnginePool *> self_; // weakly referenced by the leased sessions
+
+  std::vector<Slot> slots_;
+  std::deque<size_t> idle_;           // slots ready to be leased
+  std::deque<napi_deferred> waiters_; // pending acquire() calls
+  std::string reset_cmd_;
+  std::string start_cmd_;
+  bool closed_;
+};
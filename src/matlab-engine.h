@@ -5,6 +5,140 @@
 
 #include <stdexcept>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <string>
+#include <sstream>
+#include <utility>
+#include <vector>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/types.h>
+#endif
+
+/**
+ * \brief Time limit and cancellation of an engine call
+ * 
+ * Shared by the caller, which may cancel() the call from any thread, and the 
+ * engine, whose watchdog interrupts (and if need be kills) MATLAB when the call 
+ * is cancelled or runs out of time.
+ */
+class MatlabCallControl
+{
+public:
+  /**
+   * \param[in] timeout Time limit of the call once it starts (0 for none)
+   */
+  explicit MatlabCallControl(const std::chrono::milliseconds timeout = std::chrono::milliseconds(0))
+      : timeout_(timeout), cancelled_(false), started_(false), finished_(false), interrupted_(false), timed_out_(false) {}
+
+  /**
+   * \brief Request cancellation (any thread)
+   * 
+   * \returns true if the call has not started, in which case it is skipped
+   */
+  bool cancel()
+  {
+    bool skipped;
+    {
+      std::lock_guard<std::mutex> guard(m_);
+      cancelled_ = true;
+      skipped = !started_;
+    }
+    cv_.notify_all();
+    return skipped;
+  }
+
+  bool cancelled()
+  {
+    std::lock_guard<std::mutex> guard(m_);
+    return cancelled_;
+  }
+
+  /**
+   * \brief True if the call was cut short by cancel() or the time limit
+   */
+  bool interrupted()
+  {
+    std::lock_guard<std::mutex> guard(m_);
+    return interrupted_;
+  }
+
+  /**
+   * \brief Error message for an interrupted call
+   */
+  std::string reason()
+  {
+    std::lock_guard<std::mutex> guard(m_);
+    return timed_out_ ? "MATLAB evaluation timed out." : "MATLAB evaluation was aborted.";
+  }
+
+  /**
+   * \brief Mark the call started (engine)
+   * 
+   * \returns false if the call has been cancelled and must be skipped
+   */
+  bool start()
+  {
+    std::lock_guard<std::mutex> guard(m_);
+    started_ = !cancelled_;
+    return started_;
+  }
+
+  /**
+   * \brief Block until the started call finishes (returns false), is cancelled or times out (returns true)
+   */
+  bool watch()
+  {
+    std::unique_lock<std::mutex> lock(m_);
+    auto stop = [this] { return finished_ || cancelled_; };
+    if (timeout_.count() > 0)
+      timed_out_ = !cv_.wait_for(lock, timeout_, stop);
+    else
+      cv_.wait(lock, stop);
+    interrupted_ = !finished_;
+    return interrupted_;
+  }
+
+  /**
+   * \brief Wait up to the given time for the call to finish
+   */
+  bool wait_finished(const std::chrono::milliseconds timeout)
+  {
+    std::unique_lock<std::mutex> lock(m_);
+    return cv_.wait_for(lock, timeout, [this] { return finished_; });
+  }
+
+  /**
+   * \brief Mark the call finished (engine)
+   */
+  void finish()
+  {
+    {
+      std::lock_guard<std::mutex> guard(m_);
+      finished_ = true;
+    }
+    cv_.notify_all();
+  }
+
+private:
+  std::chrono::milliseconds timeout_;
+  std::mutex m_;
+  std::condition_variable cv_;
+  bool cancelled_;
+  bool started_;
+  bool finished_;
+  bool interrupted_;
+  bool timed_out_;
+};
 
 class MatlabEngine
 {
@@ -12,18 +146,16 @@ public:
   /**
  * \brief   Constructor
  * 
- * \param[in] bufsz      Output buffer size (default: 256)
  * \param[in] defer_open True to not open Matlab session immediately (default: false)
+ * \param[in] startcmd   Command to start MATLAB, passed to engOpen() (default: "", the local matlab)
  */
-  MatlabEngine(const size_t bufsz = 256, bool defer_open = false) : ep(nullptr), bufena(true)
+  MatlabEngine(bool defer_open = false, const std::string &startcmd = std::string())
+      : ep(nullptr), startcmd(startcmd), pid(0), killable(true), killed(false), closing(false), stopping(false)
   {
-    if (bufsz == 0)
-      throw std::runtime_error("Buffer size must be positive.");
-
-    buf.reserve(bufsz);
-
     if (!defer_open)
-      open(0);
+      open();
+
+    worker = std::thread(&MatlabEngine::run, this);
   }
 
   // disable copy & move constructors and assignment operators
@@ -34,64 +166,285 @@ public:
 
   /**
  * \brief Destructor
+ * 
+ * Does not wait for the queued work: the queued tasks still run, so that they can
+ * report back, but their engine calls fail right away. The running call is cut short
+ * as a timed-out one is, except that it is waited for if it cannot be interrupted 
+ * (process ID unknown).
  */
   ~MatlabEngine()
   {
+    closing = true;
+    killable = true; // no one else is left to use the session
+    {
+      std::lock_guard<std::mutex> guard(qm);
+      stopping = true;
+    }
+    qcv.notify_one();
+
+    if (m.try_lock())
+      m.unlock();
+    else if (!(interrupt() && waitUnlocked(killGracePeriod)))
+      kill();
+    worker.join();
+
     close();
   }
 
+  /**
+   * \brief Queue a task to be run on the engine's worker thread
+   * 
+   * Tasks are run one at a time in the order they are posted. A task is 
+   * expected to call the blocking engine functions (eval(), getVariable(), 
+   * etc.) and must not throw.
+   * 
+   * \param[in] task Function object to run on the worker thread
+   */
+  void post(std::function<void()> task)
+  {
+    {
+      std::lock_guard<std::mutex> guard(qm);
+      tasks.push_back(Task{std::move(task), std::string(), nullptr});
+    }
+    qcv.notify_one();
+  }
+
+  /**
+   * \brief Let go of a reference to an engine, from any thread
+   * 
+   * A task holding a reference may be deleted on the engine's own worker thread,
+   * which cannot join itself. There, the reference is handed to a helper thread
+   * so that the engine, if this was its last owner, is destroyed from outside.
+   */
+  static void release(std::shared_ptr<MatlabEngine> &eng)
+  {
+    if (eng && std::this_thread::get_id() == eng->worker.get_id())
+      std::thread([eng = std::move(eng)]() mutable { eng.reset(); }).detach();
+    eng.reset();
+  }
+
+  /**
+   * \brief Queue an expression to be evaluated on the worker thread, discarding its output
+   * 
+   * Runs in order with the posted tasks. Evaluations which are queued back-to-back
+   * are merged into a single engine round trip (up to maxEvalBatch of them). Each 
+   * expression of a merged batch is evaluated in its own try block so that an error 
+   * in one does not skip the following ones, as with separate evaluations, and the 
+   * error of each is reported to its own done function.
+   * 
+   * \param[in] expr Expression to evaluate in Matlab
+   * \param[in] done Called on the worker thread after the evaluation with the MATLAB
+   *                 error message (truncated to maxErrorLength characters) or the 
+   *                 reason the engine was not available, or an empty string if the 
+   *                 evaluation succeeded. Must not throw.
+   */
+  void postEval(std::string expr, std::function<void(const std::string &)> done)
+  {
+    {
+      std::lock_guard<std::mutex> guard(qm);
+      tasks.push_back(Task{nullptr, std::move(expr), std::move(done)});
+    }
+    qcv.notify_one();
+  }
+
+  static constexpr size_t maxEvalBatch = 64;
+  static constexpr size_t maxErrorLength = 200;
+
   /**
  * \brief Open Matlab session
  * 
  * If already open, does nothing
- * 
- * \param[in] bufsz Output buffer size (0 to keep the previous value)
  */
-  void open(const size_t bufsz = 0)
+  void open()
   {
-    if (ep)
-      return;
+    std::lock_guard<std::mutex> guard(m);
+    openSession();
+  }
 
-    if (!(ep = engOpen("")))
-      throw std::runtime_error("Failed to open MATLAB.");
+  /**
+   * \brief Interrupt the running evaluation (POSIX only: as Ctrl-C does)
+   */
+  bool interrupt()
+  {
+#ifdef _WIN32
+    return false;
+#else
+    long id = pid;
+    return id && ::kill((pid_t)id, SIGINT) == 0;
+#endif
+  }
 
-    if (bufsz > 0)
-      setBufferSize(bufsz);
+  /**
+   * \brief True unless the MATLAB process is known to be gone
+   */
+  bool alive()
+  {
+#ifdef _WIN32
+    return true;
+#else
+    long id = pid;
+    return !id || ::kill((pid_t)id, 0) == 0;
+#endif
   }
 
   /**
-   * \brief Close Matlab
+   * \brief Kill the MATLAB process, making the blocked engine calls fail (POSIX only)
+   * 
+   * The session is replaced by a new one by recover(). Does nothing if the 
+   * process ID is unknown or the engine is not killable.
    */
-  void close()
+  bool kill()
   {
-    if (ep)
+#ifdef _WIN32
+    return false;
+#else
+    long id = pid;
+    if (!id || !killable)
+      return false;
+    killed = true;
+    return ::kill((pid_t)id, SIGKILL) == 0;
+#endif
+  }
+
+  /**
+   * \brief Start a new MATLAB session if the previous one was killed
+   * 
+   * Called by the worker thread after each task. If MATLAB fails to start,
+   * the engine is left closed.
+   */
+  void recover()
+  {
+    if (!killed)
+      return;
+
+    std::lock_guard<std::mutex> guard(m);
+    if (!killed || closing) // recovered by another thread meanwhile, or closed by the destructor
+      return;
+    killed = false;
+    closeSession();
+    try
+    {
+      openSession();
+    }
+    catch (...)
     {
-      engClose(ep);
-      ep = nullptr;
     }
   }
 
+  /**
+   * \brief Close Matlab
+   */
+  void close()
+  {
+    std::lock_guard<std::mutex> guard(m);
+    closeSession();
+  }
+
+  /**
+   * \brief Allow or forbid kill() (forbid for a session which others may be using)
+   */
+  void setKillable(const bool tf) { killable = tf; }
+
+  /**
+   * \brief Command used to start MATLAB (empty for the default)
+   */
+  const std::string &getStartCommand() const { return startcmd; }
+
   /**
    * \brief Returns true if Matlab session is open.
    */
-  bool isopen() { return ep; }
+  bool isopen() { return ep != nullptr; }
 
   /**
    * \brief Evaluate expression in MATLAB
    * 
-   * \param[in] expr Expression to evalaute in Matlab
+   * \param[in] expr  Expression to evalaute in Matlab
+   * \param[in] bufsz Maximum number of characters of the output to return (0 to discard the output)
+   * \param[in] ctl   Time limit and cancellation of the evaluation, or nullptr
+   * \returns the output of the evaluation (up to bufsz characters)
    */
-  const std::string &eval(const std::string &expr)
+  std::string eval(const std::string &expr, const size_t bufsz = 0, MatlabCallControl *ctl = nullptr)
   {
     std::lock_guard<std::mutex> guard(m);
-    if (engEvalString(ep, expr.c_str()) > 0)
+    if (!ep || closing)
+      throw std::runtime_error("MATLAB is not open.");
+
+    Watchdog watchdog(*this, ctl);
+    std::string buf(bufsz + 1, '\0'); // engine writes null-terminated output
+    engOutputBuffer(ep, bufsz ? &buf[0] : nullptr, bufsz ? (int)buf.size() : 0);
+
+    int rc = engEvalString(ep, expr.c_str());
+    engOutputBuffer(ep, nullptr, 0);
+    watchdog.check();
+    buf.resize(std::strlen(buf.c_str()));
+    if (rc)
       throw std::runtime_error("MATLAB is not open.");
-    if (bufena)
-      engOutputBuffer(ep, buf.data(), (int)buf.size());
 
     return buf;
   }
 
+  /**
+   * \brief Evaluate a MATLAB function
+   * 
+   * The function is called through feval() so that a workspace variable of the 
+   * same name does not shadow it. The arguments are passed in and the outputs 
+   * are retrieved as one cell array each, which takes 4 engine round trips under
+   * a single lock regardless of the number of arguments and outputs. This uses 
+   * the workspace variables njs_fevalin, njs_fevalout and njs_fevalans (their 
+   * previous values are lost), which are cleared before returning. ans is left 
+   * as it was.
+   * 
+   * \param[in] name    Name of the function (may be package-qualified)
+   * \param[in] nargout Number of outputs to return
+   * \param[in] args    Cell array of input arguments
+   * \returns 1-by-nargout cell array of outputs (caller is responsible to destroy it)
+   */
+  mxArray *feval(const std::string &name, const int nargout, const mxArray *args)
+  {
+    if (!isFunctionName(name))
+      throw std::runtime_error("Invalid function name.");
+
+    if (!mxIsCell(args))
+      throw std::runtime_error("Function arguments must be given as a cell array.");
+
+    // the outputs, or the error message (isFunctionName() guarantees that name needs no escaping)
+    std::ostringstream cmd;
+    if (nargout > 0)
+      cmd << "njs_fevalout=cell(1," << nargout << ");try,[njs_fevalout{:}]=";
+    else // the call may set ans: put it back afterwards
+      cmd << "njs_fevalout=cell(1,0);if exist('ans','var'),njs_fevalans={ans};else,njs_fevalans={};end;try,";
+    cmd << "feval('" << name << "',njs_fevalin{:});catch,njs_fevalout=lasterr;end";
+    if (nargout <= 0)
+      cmd << ";if isempty(njs_fevalans),clear ans;else,ans=njs_fevalans{1};end";
+
+    std::lock_guard<std::mutex> guard(m);
+    if (!ep || closing)
+      throw std::runtime_error("MATLAB is not open.");
+    engOutputBuffer(ep, nullptr, 0);
+
+    mxArray *rval(nullptr);
+    bool put = !engPutVariable(ep, "njs_fevalin", args);
+    int rc = put ? engEvalString(ep, cmd.str().c_str()) : 0;
+    if (put && !rc)
+      rval = engGetVariable(ep, "njs_fevalout");
+    engEvalString(ep, "clear njs_fevalin njs_fevalout njs_fevalans"); // one trailing clean-up, whatever failed
+
+    if (!put)
+      throw std::runtime_error("Failed to pass function arguments to MATLAB.");
+    if (rc)
+      throw std::runtime_error("MATLAB is not open.");
+    if (!rval)
+      throw std::runtime_error("Failed to retrieve function outputs from MATLAB.");
+
+    if (mxIsChar(rval)) // error message
+    {
+      std::string msg(mxArrayToStringSafe(rval));
+      mxDestroyArray(rval);
+      throw std::runtime_error(msg);
+    }
+    return rval;
+  }
+
   /**
    * \brief Get a variable from MATLAB
    * 
@@ -99,11 +452,10 @@ public:
    */
   mxArray *getVariable(std::string name)
   {
-    if (!ep)
-      throw std::runtime_error("MATLAB is not open.");
-
     mxArray *rval;
     std::lock_guard<std::mutex> guard(m);
+    if (!ep || closing)
+      throw std::runtime_error("MATLAB is not open.");
     if (!(rval = engGetVariable(ep, name.c_str())))
       throw std::runtime_error("Invalid variable name.");
     return rval;
@@ -115,26 +467,74 @@ public:
    * \param[in] name Name of the variable in MATLAB
    * \param[in] value Value of the variable
    */
-  void putVariable(const std::string &name, mxArray *value)
+  void putVariable(const std::string &name, const mxArray *value)
   {
-    if (!ep)
-      throw std::runtime_error("MATLAB is not open.");
-
     std::lock_guard<std::mutex> guard(m);
+    if (!ep || closing)
+      throw std::runtime_error("MATLAB is not open.");
     if (engPutVariable(ep, name.c_str(), value))
       throw std::runtime_error("Invalid variable name.");
   }
 
   /**
-   * \brief Determine visibility of MATLAB session
+   * \brief Get variables from MATLAB
+   * 
+   * All the variables are retrieved back-to-back under a single lock.
+   * 
+   * \param[in] names Names of the variables in Matlab
+   * \returns the variables in the order of names (caller is responsible to destroy them)
    */
-  bool getVisible()
+  std::vector<mxArray *> getVariables(const std::vector<std::string> &names)
   {
-    if (!ep)
+    std::vector<mxArray *> rval;
+    rval.reserve(names.size());
+
+    std::lock_guard<std::mutex> guard(m);
+    if (!ep || closing)
       throw std::runtime_error("MATLAB is not open.");
+    for (auto &name : names)
+    {
+      mxArray *array = engGetVariable(ep, name.c_str());
+      if (!array)
+      {
+        for (auto *a : rval)
+          mxDestroyArray(a);
+        throw std::runtime_error("Invalid variable name: " + name);
+      }
+      rval.push_back(array);
+    }
+    return rval;
+  }
+
+  /**
+   * \brief Put variables into MATLAB
+   * 
+   * All the variables are sent back-to-back under a single lock. If one 
+   * fails, the preceding variables remain assigned.
+   * 
+   * \param[in] vars Pairs of the variable name and value
+   */
+  void putVariables(const std::vector<std::pair<std::string, const mxArray *>> &vars)
+  {
+    std::lock_guard<std::mutex> guard(m);
+    if (!ep || closing)
+      throw std::runtime_error("MATLAB is not open.");
+    for (auto &var : vars)
+    {
+      if (engPutVariable(ep, var.first.c_str(), var.second))
+        throw std::runtime_error("Invalid variable name: " + var.first);
+    }
+  }
 
+  /**
+   * \brief Determine visibility of MATLAB session
+   */
+  bool getVisible()
+  {
     bool rval;
     std::lock_guard<std::mutex> guard(m);
+    if (!ep || closing)
+      throw std::runtime_error("MATLAB is not open.");
     engGetVisible(ep, &rval);
     return rval;
   }
@@ -146,55 +546,290 @@ public:
    */
   void setVisible(const bool tf)
   {
-    if (!ep)
-      throw std::runtime_error("MATLAB is not open.");
     std::lock_guard<std::mutex> guard(m);
+    if (!ep || closing)
+      throw std::runtime_error("MATLAB is not open.");
     engSetVisible(ep, (bool)tf);
   }
 
   /**
-   * \brief True if eval() returns its output
+   * \brief True if name is a valid (package-qualified) MATLAB function name
    */
-  bool getBufferEnabled() const { return bufena; }
+  static bool isFunctionName(const std::string &name)
+  {
+    bool head = true; // expecting the first character of an identifier
+    for (char c : name)
+    {
+      if (c == '.' && !head)
+        head = true;
+      else if (std::isalpha((unsigned char)c) || (!head && (std::isdigit((unsigned char)c) || c == '_')))
+        head = false;
+      else
+        return false;
+    }
+    return !head;
+  }
+
+  std::atomic<Engine *> ep;
+  std::mutex m; // guards the engine calls and opening & closing ep
+
+private:
+  std::string startcmd; // engOpen() argument
+
+  std::atomic<long> pid;      // MATLAB process ID (0 if unknown, not on this host or on Windows)
+  std::atomic<bool> killable; // kill() allowed
+  std::atomic<bool> killed;   // MATLAB process was killed: recover() at the next opportunity
+  std::atomic<bool> closing;  // being destroyed: engine calls fail right away
 
   /**
-   * \brief Set output handling of eval()
-   * 
-   * \param[in] tf True to make eval() returns its printed output; false to ignore output
+   * \brief Wait up to the given time for the running engine call to return
    */
-  void setBufferEnabled(const bool tf)
+  bool waitUnlocked(const std::chrono::milliseconds timeout)
   {
-    bufena = tf;
-    if (!tf) // if disabled, clear current buffer content
-      buf.clear();
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!m.try_lock())
+    {
+      if (std::chrono::steady_clock::now() >= deadline)
+        return false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    m.unlock();
+    return true;
   }
 
   /**
-   * \brief True if eval() returns its output
+   * \brief Open the session unless open (m must be locked)
    */
-  size_t getBufferSize() const { return buf.capacity(); }
+  void openSession()
+  {
+    if (ep)
+      return;
+
+    if (!(ep = engOpen(startcmd.c_str())))
+      throw std::runtime_error("Failed to open MATLAB.");
+
+#ifndef _WIN32
+    // process ID to interrupt or kill runaway evaluations, only meaningful if MATLAB runs
+    // on this host: a start command may run it elsewhere (e.g., over ssh). Not on Windows,
+    // where the engine connects to the automation server which other programs may share.
+    mxArray *id;
+    engOutputBuffer(ep, nullptr, 0);
+    if (startcmd.empty() && !engEvalString(ep, "njs_pid=feature('getpid');") && (id = engGetVariable(ep, "njs_pid")))
+    {
+      pid = (long)mxGetScalar(id);
+      mxDestroyArray(id);
+      engEvalString(ep, "clear njs_pid");
+    }
+#endif
+  }
 
   /**
-   * \brief Set eval output buffer size
+   * \brief Close the session if open (m must be locked)
+   */
+  void closeSession()
+  {
+    if (ep)
+    {
+      engClose(ep);
+      ep = nullptr;
+    }
+    pid = 0;
+  }
+
+  static std::string mxArrayToStringSafe(const mxArray *array)
+  {
+    char *str = mxArrayToString(array);
+    if (!str)
+      return "MATLAB function evaluation failed.";
+    std::string rval(str);
+    mxFree(str);
+    return rval;
+  }
+
+  /**
+   * \brief Watches an engine call under a MatlabCallControl
    * 
-   * \param[in] sz   Buffer size (if 0, unchanged)
+   * Interrupts MATLAB once the call is cancelled or times out, and kills it if 
+   * the call does not return within killGracePeriod afterwards. Without a known
+   * process ID, MATLAB is left alone: the call then fails once it returns.
    */
-  void setBufferSize(const size_t sz)
+  class Watchdog
   {
-    if (sz)
-      buf.reserve(sz);
+  public:
+    /**
+     * \throws std::runtime_error if the call has already been cancelled
+     */
+    Watchdog(MatlabEngine &eng, MatlabCallControl *ctl) : ctl_(ctl)
+    {
+      if (!ctl_)
+        return;
+      if (!ctl_->start())
+        throw std::runtime_error(ctl_->reason());
+      thread_ = std::thread([&eng, ctl]() {
+        if (ctl->watch() && !(eng.interrupt() && ctl->wait_finished(killGracePeriod) && eng.alive()))
+          eng.kill(); // also marks a session which did not survive the interrupt for recovery
+      });
+    }
+
+    ~Watchdog() { stop(); }
+
+    /**
+     * \brief Call this once the call has returned
+     * 
+     * \returns true if the call was interrupted
+     */
+    bool stop()
+    {
+      if (thread_.joinable())
+      {
+        ctl_->finish();
+        thread_.join();
+      }
+      return ctl_ && ctl_->interrupted();
+    }
+
+    /**
+     * \brief Same as stop() but throws if the call was interrupted
+     */
+    void check()
+    {
+      if (stop())
+        throw std::runtime_error(ctl_->reason());
+    }
+
+  private:
+    MatlabCallControl *ctl_;
+    std::thread thread_;
+  };
+
+  static constexpr std::chrono::milliseconds killGracePeriod{500};
+
+  /**
+   * \brief MATLAB char array expression of a string
+   */
+  static std::string charLiteral(const std::string &str)
+  {
+    std::string rval("['");
+    for (char c : str)
+    {
+      if (c == '\'')
+        rval += "''";
+      else if (c == '\n' || c == '\r')
+        rval += c == '\n' ? "' char(10) '" : "' char(13) '";
+      else
+        rval += c;
+    }
+    return rval + "']";
   }
 
   /**
-   * \brief Return current buffer content
+   * \brief Evaluate expressions in one engine call, discarding their output
+   * 
+   * Each expression is evaluated by evalc(), which swallows its output, in its own try 
+   * block. The catch blocks print a record of char(1), the index and the error message of 
+   * the expression, which is then the only output of the call.
    * 
-   * \returns Current buffer content
+   * \returns the error message of each expression (empty if it succeeded)
+   */
+  std::vector<std::string> evalBatch(const std::vector<std::string> &exprs)
+  {
+    std::string cmd;
+    for (size_t i = 0; i < exprs.size(); ++i)
+      cmd += "try,evalc(" + charLiteral(exprs[i]) + ");catch,fprintf('%c%d:%." + std::to_string(maxErrorLength) +
+             "s',1," + std::to_string(i) + ",lasterr);end\n";
+
+    std::vector<std::string> errors(exprs.size());
+    std::vector<char> out(exprs.size() * (maxErrorLength + 8) + 1, '\0'); // room for all the records
+    {
+      std::lock_guard<std::mutex> guard(m);
+      int rc = 1; // not open
+      if (ep && !closing)
+      {
+        engOutputBuffer(ep, out.data(), (int)out.size());
+        rc = engEvalString(ep, cmd.c_str());
+        engOutputBuffer(ep, nullptr, 0);
+      }
+      if (rc)
+      {
+        for (auto &error : errors)
+          error = "MATLAB is not open.";
+        return errors;
+      }
+    }
+
+    for (const char *rec = std::strchr(out.data(), '\1'); rec;)
+    {
+      char *msg;
+      size_t i = std::strtoul(rec + 1, &msg, 10);
+      rec = std::strchr(msg, '\1');
+      if (*msg++ != ':' || i >= errors.size())
+        continue;
+      errors[i].assign(msg, rec ? size_t(rec - msg) : std::strlen(msg));
+      if (errors[i].empty())
+        errors[i] = "MATLAB evaluation failed.";
+    }
+    return errors;
+  }
+
+  /**
+   * \brief Worker thread loop: run posted tasks until the engine is destroyed
    */
-  const std::string &getBuffer() { return buf; }
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(qm);
+    for (;;)
+    {
+      qcv.wait(lock, [this] { return stopping || !tasks.empty(); });
+      if (tasks.empty()) // stopping & all tasks done
+        return;
+
+      Task task = std::move(tasks.front());
+      tasks.pop_front();
 
-  Engine *ep;
-  std::mutex m;
+      if (task.fn)
+      {
+        lock.unlock();
+        task.fn();
+        recover();
+        lock.lock();
+        continue;
+      }
+
+      // merge the evaluations queued back-to-back
+      std::vector<Task> batch;
+      batch.push_back(std::move(task));
+      while (!tasks.empty() && !tasks.front().fn && batch.size() < maxEvalBatch)
+      {
+        batch.push_back(std::move(tasks.front()));
+        tasks.pop_front();
+      }
+
+      lock.unlock();
+      std::vector<std::string> exprs;
+      exprs.reserve(batch.size());
+      for (auto &t : batch)
+        exprs.push_back(std::move(t.expr));
+      std::vector<std::string> errors = evalBatch(exprs);
+      for (size_t i = 0; i < batch.size(); ++i)
+        batch[i].done(errors[i]);
+      recover();
+      lock.lock();
+    }
+  }
+
+  /**
+   * \brief Queued task: a function to run or an expression to evaluate (fn is empty)
+   */
+  struct Task
+  {
+    std::function<void()> fn;
+    std::string expr;
+    std::function<void(const std::string &)> done;
+  };
 
-  bool bufena;
-  std::string buf;
+  std::thread worker;
+  std::mutex qm;               // guards tasks & stopping
+  std::condition_variable qcv; // signals new task or stop request
+  std::deque<Task> tasks;
+  bool stopping;
 };
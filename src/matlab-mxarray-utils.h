@@ -7,38 +7,181 @@
 
 #pragma once
 
+#include "matlab-mxarray.h"
+#include "napi_utils.h"
+
 #include <mex.h>
 #include <node_api.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
 #include <string>
 #include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// MATLAB R2018a+ headers define it as 1 if built with the interleaved complex API (-R2018a)
+#ifndef MX_HAS_INTERLEAVED_COMPLEX
+#define MX_HAS_INTERLEAVED_COMPLEX 0
+#endif
 
 typedef std::unique_ptr<mxArray, decltype(mxDestroyArray) *> managedMxArray;
 
+/**
+ * \brief Typed array contents prepared off the JavaScript thread
+ * 
+ * prepare_mxarray_buffers() fills them on a worker thread with the mxArray data which 
+ * mxArrayToNapiValue() would otherwise copy, interleave or pack on the JavaScript thread.
+ * Each buffer is keyed by the data it is made from and how, and becomes an external array
+ * buffer owning it alone, so that the typed arrays of a value do not keep one another alive.
+ */
+class MxArrayBuffers
+{
+public:
+  enum Layout
+  {
+    Copy,        // as is
+    Interleaved, // [re0, im0, re1, im1, ...] from separate parts
+    RealPart,    // real part of interleaved complex data
+    ImagPart,    // imaginary part of interleaved complex data
+    PackedBits   // logicals packed 8 per byte
+  };
+
+  /**
+   * \brief Smaller blocks are left to the JavaScript thread, which copies them faster than it 
+   *        wraps them as external array buffers
+   */
+  static constexpr size_t min_bytes = 1 << 16;
+
+  /**
+   * \brief Allocate the buffer of a block (worker thread)
+   */
+  void *add(const void *src, const Layout layout, const size_t byte_length)
+  {
+    Buffer &buf = buffers_[std::make_pair(src, layout)];
+    buf.data.reset(new uint8_t[byte_length], std::default_delete<uint8_t[]>());
+    buf.byte_length = byte_length;
+    return buf.data.get();
+  }
+
+  /**
+   * \brief The buffer of a block or nullptr if not prepared
+   */
+  std::shared_ptr<void> find(const void *src, const Layout layout, const size_t byte_length) const
+  {
+    auto it = buffers_.find(std::make_pair(src, layout));
+    if (it == buffers_.end() || it->second.byte_length != byte_length)
+      return nullptr;
+    return it->second.data;
+  }
+
+private:
+  struct Buffer
+  {
+    std::shared_ptr<void> data;
+    size_t byte_length;
+  };
+  std::map<std::pair<const void *, Layout>, Buffer> buffers_;
+};
+
+/**
+ * \brief Options of mxArray to N-API value conversion
+ */
+struct MxArrayToNapiOptions
+{
+  /**
+   * \brief False to let typed arrays reference the mxArray data instead of copying it
+   * 
+   * Only effective if owner is set, in which case the external array buffers share the 
+   * ownership of the (root) mxArray, which is destroyed once all of them are garbage
+   * collected.
+   */
+  bool copy = true;
+  std::shared_ptr<mxArray> owner;
+
+  /**
+   * \brief True to pack non-scalar logical arrays 8 elements per byte (LSB first)
+   */
+  bool pack_logicals = false;
+
+  /**
+   * \brief True to return complex arrays as one typed array of interleaved real & imaginary parts
+   */
+  bool interleaved_complex = false;
+
+  /**
+   * \brief True to return non-scalar struct arrays as one object of field columns
+   */
+  bool columnar = false;
+
+  /**
+   * \brief Buffers prepared by prepare_mxarray_buffers() for the converted array (optional)
+   */
+  std::shared_ptr<const MxArrayBuffers> buffers;
+};
+
+/**
+ * \brief Parse JavaScript conversion options
+ * 
+ *    options <Object>
+ *       copy         <boolean> False to reference the MATLAB array data from typed arrays. Default: true
+ *       packLogicals <boolean> True to return logical arrays as bitsets. Default: false
+ *       interleavedComplex <boolean> True to return complex arrays as [re0, im0, re1, im1, ...]. 
+ *                                    Default: false
+ *       columnar     <boolean> True to return struct arrays as an object of columns. Default: false
+ */
+inline MxArrayToNapiOptions napi_get_mxarray_options(napi_env env, napi_value jsopts)
+{
+  MxArrayToNapiOptions opts;
+  opts.copy = napi_get_option_bool(env, jsopts, "copy", true);
+  opts.pack_logicals = napi_get_option_bool(env, jsopts, "packLogicals", false);
+  opts.interleaved_complex = napi_get_option_bool(env, jsopts, "interleavedComplex", false);
+  opts.columnar = napi_get_option_bool(env, jsopts, "columnar", false);
+  return opts;
+}
+
 // helper function prototypes
+void set_dims(napi_env env, napi_value value, const mxArray *array); // attach dims property
 template <typename data_type, typename MxGetFun>
-napi_value to_typedarray(napi_env env, const napi_typedarray_type type, const mxArray *array, MxGetFun mxGet); // logical scalar (or array with index arg)
+napi_value to_typedarray(napi_env env, const napi_typedarray_type type, const mxArray *array, MxGetFun mxGet,
+                         const MxArrayToNapiOptions &opts); // logical scalar (or array with index arg)
 template <typename data_type>
-napi_value from_numeric(napi_env env, const mxArray *array, const napi_typedarray_type type); // logical scalar (or array with index arg)
-napi_value from_chars(napi_env env, const mxArray *array);                                    // char string
-napi_value from_logicals(napi_env env, const mxArray *array);
-napi_value from_cell(napi_env env, const mxArray *array);                   // for a struct
-napi_value from_struct(napi_env env, const mxArray *array, int index = -1); // for a cell
+napi_value from_numeric(napi_env env, const mxArray *array, const napi_typedarray_type type,
+                        const MxArrayToNapiOptions &opts); // logical scalar (or array with index arg)
+napi_value from_chars(napi_env env, const mxArray *array); // char string (or array of row strings)
+napi_value from_cellstr(napi_env env, const mxArray *array); // array of strings
+napi_value from_logicals(napi_env env, const mxArray *array, const MxArrayToNapiOptions &opts);
+napi_value from_cell(napi_env env, const mxArray *array, const MxArrayToNapiOptions &opts);                   // for a struct
+napi_value from_sparse(napi_env env, const mxArray *array, const MxArrayToNapiOptions &opts);                 // CSC object
+napi_value from_struct(napi_env env, const mxArray *array, const MxArrayToNapiOptions &opts, int index = -1,
+                       const std::vector<napi_value> *keys = nullptr); // for a cell
+napi_value from_struct_columns(napi_env env, const mxArray *array, const MxArrayToNapiOptions &opts);
+mxArray *from_string(napi_env env, const napi_value value);
 mxArray *from_object(napi_env env, const napi_value value);
 mxArray *from_array(napi_env env, const napi_value value);       // for cell
-mxArray *from_typedarray(napi_env env, const napi_value value);  // numeric vector
+mxArray *from_typedarray(napi_env env, const napi_value value, napi_value shape = nullptr); // numeric array
+mxArray *from_logical_typedarray(napi_env env, const napi_value value, const napi_value shape, const uint8_t *data, size_t length);
+mxArray *from_complex_typedarray(napi_env env, const napi_value shape, const mxClassID classid, const void *data, size_t length);
+std::vector<mwSize> get_dims(napi_env env, const napi_value value);
+std::vector<mwSize> get_dims(napi_env env, const napi_value value, const size_t nelem);
+bool is_shaped_typedarray(napi_env env, const napi_value value, napi_value &data);
 mxArray *from_arraybuffer(napi_env env, const napi_value value); // numeric vector
 mxArray *from_buffer(napi_env env, const napi_value value);      // numeric vector
 mxArray *from_dataview(napi_env env, const napi_value value);    // numeric vector
+mxArray *from_sparse_object(napi_env env, const napi_value value); // {m, n, ir, jc, pr[, pi]}
 
 /**
  * \brief   Convert form Matlab mxArray to N-API value
  * 
  * \param[in] env N-API context
  * \param[in] array Matlab mxArray opaque object
- * \returns N-API value containing a copy of val
+ * \param[in] opts Conversion options
+ * \returns N-API value containing a copy of val (or referencing its data)
  */
-inline napi_value mxArrayToNapiValue(napi_env env, const mxArray *array)
+inline napi_value mxArrayToNapiValue(napi_env env, const mxArray *array, const MxArrayToNapiOptions &opts)
 {
   napi_value rval(nullptr);
   if (mxIsEmpty(array))
@@ -46,48 +189,56 @@ inline napi_value mxArrayToNapiValue(napi_env env, const mxArray *array)
     if (napi_get_null(env, &rval) != napi_ok)
       throw std::runtime_error("Failed to create null JavaScript object");
   }
+  else if (mxIsSparse(array))
+  {
+    rval = from_sparse(env, array, opts);
+  }
   else
   {
     switch (mxGetClassID(array))
     {
     case mxCELL_CLASS:
-      rval = from_cell(env, array);
+      rval = from_cell(env, array, opts);
       break;
     case mxSTRUCT_CLASS:
-      rval = from_struct(env, array);
+      rval = from_struct(env, array, opts);
       break;
     case mxLOGICAL_CLASS:
-      rval = from_logicals(env, array);
+      rval = from_logicals(env, array, opts);
       break;
     case mxCHAR_CLASS:
       rval = from_chars(env, array);
       break;
     case mxDOUBLE_CLASS:
-      rval = from_numeric<double>(env, array, napi_float64_array);
+      rval = from_numeric<double>(env, array, napi_float64_array, opts);
       break;
     case mxSINGLE_CLASS:
-      rval = from_numeric<float>(env, array, napi_float32_array);
+      rval = from_numeric<float>(env, array, napi_float32_array, opts);
       break;
     case mxINT8_CLASS:
-      rval = from_numeric<int8_t>(env, array, napi_int8_array);
+      rval = from_numeric<int8_t>(env, array, napi_int8_array, opts);
       break;
     case mxUINT8_CLASS:
-      rval = from_numeric<uint8_t>(env, array, napi_uint8_array);
+      rval = from_numeric<uint8_t>(env, array, napi_uint8_array, opts);
       break;
     case mxINT16_CLASS:
-      rval = from_numeric<int16_t>(env, array, napi_int16_array);
+      rval = from_numeric<int16_t>(env, array, napi_int16_array, opts);
       break;
     case mxUINT16_CLASS:
-      rval = from_numeric<uint16_t>(env, array, napi_uint16_array);
+      rval = from_numeric<uint16_t>(env, array, napi_uint16_array, opts);
       break;
     case mxINT32_CLASS:
-      rval = from_numeric<int32_t>(env, array, napi_int32_array);
+      rval = from_numeric<int32_t>(env, array, napi_int32_array, opts);
       break;
     case mxUINT32_CLASS:
-      rval = from_numeric<uint32_t>(env, array, napi_uint32_array);
+      rval = from_numeric<uint32_t>(env, array, napi_uint32_array, opts);
       break;
     case mxINT64_CLASS:
+      rval = from_numeric<int64_t>(env, array, napi_bigint64_array, opts);
+      break;
     case mxUINT64_CLASS:
+      rval = from_numeric<uint64_t>(env, array, napi_biguint64_array, opts);
+      break;
     case mxVOID_CLASS:
     case mxFUNCTION_CLASS:
     case mxUNKNOWN_CLASS:
@@ -98,6 +249,47 @@ inline napi_value mxArrayToNapiValue(napi_env env, const mxArray *array)
   return rval;
 }
 
+inline napi_value mxArrayToNapiValue(napi_env env, const mxArray *array)
+{
+  return mxArrayToNapiValue(env, array, MxArrayToNapiOptions());
+}
+
+/**
+ * \brief Limits the nesting of the JavaScript objects being converted, which also stops cyclic values
+ * 
+ * One guard lives while an object (array, struct, ...) is converted. The count is per thread.
+ */
+class NestingGuard
+{
+public:
+  static constexpr size_t max_depth = 256;
+
+  NestingGuard()
+  {
+    if (++depth() > max_depth)
+    {
+      --depth();
+      throw_too_deep();
+    }
+  }
+  ~NestingGuard() { --depth(); }
+
+  NestingGuard(const NestingGuard &) = delete;
+  NestingGuard &operator=(const NestingGuard &) = delete;
+
+  [[noreturn]] static void throw_too_deep()
+  {
+    throw std::runtime_error("JavaScript value is nested too deeply or refers to itself.");
+  }
+
+private:
+  static size_t &depth()
+  {
+    thread_local size_t count = 0;
+    return count;
+  }
+};
+
 inline mxArray *napiValueToMxArray(napi_env env, const napi_value value)
 {
   napi_valuetype type;
@@ -123,12 +315,31 @@ inline mxArray *napiValueToMxArray(napi_env env, const napi_value value)
     return mxCreateDoubleScalar(dbl_val);
   }
   case napi_string:
+    return from_string(env, value);
+  case napi_bigint: // int64 unless only representable as uint64
   {
-    std::string str_val = napi_get_value_string_utf8(env, value);
-    return mxCreateString(str_val.c_str());
+    int64_t i64_val;
+    uint64_t u64_val;
+    bool lossless;
+    if (napi_get_value_bigint_int64(env, value, &i64_val, &lossless) != napi_ok)
+      throw std::runtime_error("Failed to get BigInt JavaScript value.");
+    if (!lossless && napi_get_value_bigint_uint64(env, value, &u64_val, &lossless) == napi_ok && lossless)
+    {
+      mxArray *rval = mxCreateNumericMatrix(1, 1, mxUINT64_CLASS, mxREAL);
+      *reinterpret_cast<uint64_t *>(mxGetData(rval)) = u64_val;
+      return rval;
+    }
+    if (!lossless)
+      throw std::runtime_error("BigInt value does not fit in 64 bits.");
+    mxArray *rval = mxCreateNumericMatrix(1, 1, mxINT64_CLASS, mxREAL);
+    *reinterpret_cast<int64_t *>(mxGetData(rval)) = i64_val;
+    return rval;
   }
   case napi_object: // array or object or class?
+  {
+    NestingGuard guard;
     return from_object(env, value);
+  }
   case napi_symbol:
   case napi_undefined:
   case napi_function:
@@ -141,66 +352,492 @@ inline mxArray *napiValueToMxArray(napi_env env, const napi_value value)
 //////////////////////////////////////////////////////////////////////////////////////////////////
 ///   Matlab mxArray to N-API value helper functions
 
+/**
+ * \brief Attach MATLAB array dimensions to a JavaScript object as its dims property
+ */
+inline void set_dims(napi_env env, napi_value value, const mxArray *array)
+{
+  mwSize ndims = mxGetNumberOfDimensions(array);
+  const mwSize *dims = mxGetDimensions(array);
+
+  napi_value jsdims;
+  if (napi_create_array_with_length(env, ndims, &jsdims) != napi_ok)
+    throw std::runtime_error("Failed to create JavaScript array.");
+  for (mwSize n = 0; n < ndims; ++n)
+  {
+    napi_value elem;
+    if (napi_create_double(env, (double)dims[n], &elem) != napi_ok ||
+        napi_set_element(env, jsdims, (uint32_t)n, elem) != napi_ok)
+      throw std::runtime_error("Failed to set dimension.");
+  }
+
+  if (napi_set_named_property(env, value, "dims", jsdims) != napi_ok)
+    throw std::runtime_error("Failed to set dims property.");
+}
+
+/**
+ * \brief Set a boolean property of a JavaScript object to true
+ */
+inline void set_flag(napi_env env, napi_value value, const char *name)
+{
+  napi_value flag;
+  if (napi_get_boolean(env, true, &flag) != napi_ok ||
+      napi_set_named_property(env, value, name, flag) != napi_ok)
+    throw std::runtime_error("Failed to set a flag property.");
+}
+
+/**
+ * \brief Create an array buffer referencing native data, sharing the ownership of its owner 
+ *        (the root mxArray or a prepared buffer)
+ * 
+ * \returns nullptr if the runtime does not allow external array buffers
+ */
+inline napi_value to_external_arraybuffer(napi_env env, void *data, size_t byte_length, const std::shared_ptr<void> &owner)
+{
+  napi_value arraybuffer;
+  auto *hint = new std::shared_ptr<void>(owner);
+  if (napi_create_external_arraybuffer(
+          env, data, byte_length,
+          [](napi_env /*env*/, void * /*data*/, void *hint) {
+            delete reinterpret_cast<std::shared_ptr<void> *>(hint);
+          },
+          hint, &arraybuffer) != napi_ok)
+  {
+    delete hint;
+    return nullptr;
+  }
+  return arraybuffer;
+}
+
+/**
+ * \brief Interleave real & imaginary parts: dst = [re[0], im[0], re[1], im[1], ...]
+ * 
+ * Kept as a plain loop over restrict pointers so that the compiler vectorizes it.
+ */
+template <typename data_type>
+void interleave_complex(const data_type *__restrict re, const data_type *__restrict im, data_type *__restrict dst, const size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+  {
+    dst[2 * i] = re[i];
+    dst[2 * i + 1] = im[i];
+  }
+}
+
+/**
+ * \brief Split interleaved complex data into real & imaginary parts
+ */
+template <typename data_type>
+void deinterleave_complex(const data_type *__restrict src, data_type *__restrict re, data_type *__restrict im, const size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+  {
+    re[i] = src[2 * i];
+    im[i] = src[2 * i + 1];
+  }
+}
+
+/**
+ * \brief Pack logicals 8 per byte: element i is bit (i % 8) of byte (i / 8)
+ */
+inline void pack_logicals(const mxLogical *src, const size_t nelem, uint8_t *dst)
+{
+  for (size_t i = 0; i < nelem; i += 8)
+  {
+    uint8_t byte = 0;
+    size_t nbits = std::min<size_t>(8, nelem - i);
+    for (size_t j = 0; j < nbits; ++j)
+      byte |= (uint8_t)(src[i + j] != 0) << j;
+    *dst++ = byte;
+  }
+}
+
+/**
+ * \brief Byte length of a block of nelem elements of elsize bytes in the given layout
+ */
+inline size_t buffer_length(const MxArrayBuffers::Layout layout, const size_t nelem, const size_t elsize)
+{
+  switch (layout)
+  {
+  case MxArrayBuffers::Interleaved:
+    return 2 * nelem * elsize;
+  case MxArrayBuffers::PackedBits:
+    return (nelem + 7) / 8;
+  default:
+    return nelem * elsize;
+  }
+}
+
+template <typename word_type>
+void fill_complex_buffer(void *dst, const MxArrayBuffers::Layout layout, const void *src, const void *src2, const size_t nelem)
+{
+  const word_type *s = reinterpret_cast<const word_type *>(src);
+  word_type *d = reinterpret_cast<word_type *>(dst);
+  if (layout == MxArrayBuffers::Interleaved)
+    interleave_complex(s, reinterpret_cast<const word_type *>(src2), d, nelem);
+  else // RealPart or ImagPart
+    for (size_t i = 0, j = layout == MxArrayBuffers::ImagPart; i < nelem; ++i, j += 2)
+      d[i] = s[j];
+}
+
+/**
+ * \brief Fill dst with a block of mxArray data in the given layout (any thread)
+ * 
+ * Complex data is moved bit for bit by element size, so any numeric type works.
+ * 
+ * \param[out] dst    Destination of buffer_length(layout, nelem, elsize) bytes
+ * \param[in]  layout How to arrange the data
+ * \param[in]  src    The data (the real part for Interleaved)
+ * \param[in]  src2   The imaginary part for Interleaved (unused otherwise)
+ * \param[in]  nelem  Number of elements (complex ones for Interleaved, RealPart & ImagPart)
+ * \param[in]  elsize Element size in bytes (of one part for complex data)
+ */
+inline void fill_buffer(void *dst, const MxArrayBuffers::Layout layout, const void *src, const void *src2,
+                        const size_t nelem, const size_t elsize)
+{
+  if (layout == MxArrayBuffers::Copy)
+  {
+    std::memcpy(dst, src, nelem * elsize);
+    return;
+  }
+  if (layout == MxArrayBuffers::PackedBits)
+  {
+    pack_logicals(reinterpret_cast<const mxLogical *>(src), nelem, reinterpret_cast<uint8_t *>(dst));
+    return;
+  }
+
+  switch (elsize)
+  {
+  case 1:
+    fill_complex_buffer<uint8_t>(dst, layout, src, src2, nelem);
+    break;
+  case 2:
+    fill_complex_buffer<uint16_t>(dst, layout, src, src2, nelem);
+    break;
+  case 4:
+    fill_complex_buffer<uint32_t>(dst, layout, src, src2, nelem);
+    break;
+  case 8:
+    fill_complex_buffer<uint64_t>(dst, layout, src, src2, nelem);
+    break;
+  default:
+    throw std::runtime_error("Unsupported complex element size.");
+  }
+}
+
+/**
+ * \brief Create an array buffer holding a block of mxArray data in the given layout
+ * 
+ * References the data if opts allow it (Copy layout only). Otherwise wraps its prepared
+ * buffer if any, so that large data costs the JavaScript thread no copying, or copies it.
+ */
+inline napi_value to_arraybuffer(napi_env env, const MxArrayBuffers::Layout layout, void *src, const void *src2,
+                                 const size_t nelem, const size_t elsize, const MxArrayToNapiOptions &opts)
+{
+  napi_value arraybuffer(nullptr);
+  size_t byte_length = buffer_length(layout, nelem, elsize);
+
+  if (layout == MxArrayBuffers::Copy && !opts.copy && opts.owner && byte_length) // zero-copy
+    arraybuffer = to_external_arraybuffer(env, src, byte_length, opts.owner);
+
+  std::shared_ptr<void> prepared;
+  if (!arraybuffer && opts.buffers && (prepared = opts.buffers->find(src, layout, byte_length)))
+    arraybuffer = to_external_arraybuffer(env, prepared.get(), byte_length, prepared);
+
+  if (!arraybuffer)
+  {
+    void *dst;
+    if (napi_create_arraybuffer(env, byte_length, &dst, &arraybuffer) != napi_ok)
+      throw std::runtime_error("Failed to create JavaScript Array Buffer.");
+    if (prepared) // external array buffers not allowed
+      std::memcpy(dst, prepared.get(), byte_length);
+    else
+      fill_buffer(dst, layout, src, src2, nelem, elsize);
+  }
+  return arraybuffer;
+}
+
 template <typename data_type, typename MxGetFun>
-napi_value to_typedarray(napi_env env, const napi_typedarray_type type, const mxArray *array, MxGetFun mxGet) // logical scalar (or array with index arg)
+napi_value to_typedarray(napi_env env, const napi_typedarray_type type, const mxArray *array, MxGetFun mxGet,
+                         const MxArrayToNapiOptions &opts) // logical scalar (or array with index arg)
 {
-  napi_value value, arraybuffer;
+  napi_value value;
 
-  data_type *data;
   size_t nelem = mxGetNumberOfElements(array);
-  if (napi_create_arraybuffer(env, nelem * sizeof(data_type), &reinterpret_cast<void *>(data), &arraybuffer) != napi_ok)
-    throw std::runtime_error("Failed to create JavaScript Array Buffer.");
+  napi_value arraybuffer = to_arraybuffer(env, MxArrayBuffers::Copy, mxGet(array), nullptr, nelem, sizeof(data_type), opts);
+
+  // create typed array, retaining MATLAB's (column-major) shape
+  if (napi_create_typedarray(env, type, nelem, arraybuffer, 0, &value) != napi_ok)
+    throw std::runtime_error("Failed to create typed array.");
+  set_dims(env, value, array);
+  return value;
+}
+
+/**
+ * \brief Create typed array of interleaved complex data (length 2N) with dims & complex properties
+ */
+template <typename data_type>
+napi_value to_interleaved_typedarray(napi_env env, const napi_typedarray_type type, const mxArray *array,
+                                     const MxArrayToNapiOptions &opts)
+{
+  napi_value value;
 
-  // copy data
-  std::copy_n(reinterpret_cast<data_type *>(mxGet(array)), nelem, data);
+  size_t nelem = mxGetNumberOfElements(array);
+#if MX_HAS_INTERLEAVED_COMPLEX // already laid out as such in MATLAB
+  napi_value arraybuffer = to_arraybuffer(env, MxArrayBuffers::Copy, mxGetData(array), nullptr, 2 * nelem,
+                                          sizeof(data_type), opts);
+#else
+  napi_value arraybuffer = to_arraybuffer(env, MxArrayBuffers::Interleaved, mxGetData(array), mxGetImagData(array),
+                                          nelem, sizeof(data_type), opts);
+#endif
+
+  if (napi_create_typedarray(env, type, 2 * nelem, arraybuffer, 0, &value) != napi_ok)
+    throw std::runtime_error("Failed to create typed array.");
+  set_dims(env, value, array);
+  set_flag(env, value, "complex");
+  return value;
+}
+
+#if MX_HAS_INTERLEAVED_COMPLEX
+/**
+ * \brief Create typed array of the real or imaginary part of interleaved complex data
+ */
+template <typename data_type>
+napi_value to_complex_part_typedarray(napi_env env, const napi_typedarray_type type, const mxArray *array,
+                                      const MxArrayBuffers::Layout part, const MxArrayToNapiOptions &opts)
+{
+  napi_value value;
+
+  size_t nelem = mxGetNumberOfElements(array);
+  napi_value arraybuffer = to_arraybuffer(env, part, mxGetData(array), nullptr, nelem, sizeof(data_type), opts);
 
-  // create typed array
-  if (napi_create_typedarray(env, type, mxGetNumberOfElements(array), arraybuffer, 0, &value) != napi_ok)
+  if (napi_create_typedarray(env, type, nelem, arraybuffer, 0, &value) != napi_ok)
     throw std::runtime_error("Failed to create typed array.");
+  set_dims(env, value, array);
   return value;
 }
+#endif
 
 template <typename data_type>
-napi_value from_numeric(napi_env env, const mxArray *array, const napi_typedarray_type type) // logical scalar (or array with index arg)
+napi_value from_numeric(napi_env env, const mxArray *array, const napi_typedarray_type type,
+                        const MxArrayToNapiOptions &opts) // logical scalar (or array with index arg)
 {
   napi_value rval(nullptr);
-  if (mxIsComplex(array)) // complex data, create object ot hold both real & imaginary parts
+  if (mxIsComplex(array) && opts.interleaved_complex) // complex data in one typed array
+  {
+    rval = to_interleaved_typedarray<data_type>(env, type, array, opts);
+  }
+  else if (mxIsComplex(array)) // complex data, create object ot hold both real & imaginary parts
   {
     if (napi_create_object(env, &rval) != napi_ok)
       throw std::runtime_error("Failed to create JavaScript object to hold complex number.");
 
-    if (napi_set_named_property(env, rval, "re",
-                                to_typedarray<data_type,
-                                              decltype(mxGetData) *>(env, type, array, mxGetData)) != napi_ok)
+#if MX_HAS_INTERLEAVED_COMPLEX
+    napi_value re = to_complex_part_typedarray<data_type>(env, type, array, MxArrayBuffers::RealPart, opts);
+    napi_value im = to_complex_part_typedarray<data_type>(env, type, array, MxArrayBuffers::ImagPart, opts);
+#else
+    napi_value re = to_typedarray<data_type, decltype(mxGetData) *>(env, type, array, mxGetData, opts);
+    napi_value im = to_typedarray<data_type, decltype(mxGetImagData) *>(env, type, array, mxGetImagData, opts);
+#endif
+
+    if (napi_set_named_property(env, rval, "re", re) != napi_ok)
       throw std::runtime_error("Failed to set re property.");
 
-    if (napi_set_named_property(env, rval, "im",
-                                to_typedarray<data_type,
-                                              decltype(mxGetImagData) *>(env, type, array, mxGetImagData)) != napi_ok)
+    if (napi_set_named_property(env, rval, "im", im) != napi_ok)
       throw std::runtime_error("Failed to create im property");
   }
-  else if (mxIsDouble(array)) // return a typedarray object pointing directly at mxArray data
+  else if (mxIsDouble(array) && mxIsScalar(array)) // real double scalar -> number
   {
     if (napi_create_double(env, mxGetScalar(array), &rval) != napi_ok)
       throw std::runtime_error("Failed to create a double value");
   }
   else
   {
-    rval = to_typedarray<data_type, decltype(mxGetData) *>(env, type, array, mxGetData);
+    rval = to_typedarray<data_type, decltype(mxGetData) *>(env, type, array, mxGetData, opts);
+  }
+
+  return rval;
+}
+
+/**
+ * \brief Typed array type of MATLAB index arrays (Int32Array unless built with 64-bit mwIndex)
+ */
+constexpr napi_typedarray_type mwindex_typedarray_type = sizeof(mwIndex) == 8 ? napi_bigint64_array : napi_int32_array;
+
+/**
+ * \brief Create typed array from a block of mxArray data (copied unless opts allow referencing it)
+ */
+inline napi_value data_to_typedarray(napi_env env, const napi_typedarray_type type, void *data, const size_t nelem,
+                                     const size_t elsize, const MxArrayToNapiOptions &opts)
+{
+  napi_value value;
+  napi_value arraybuffer = to_arraybuffer(env, MxArrayBuffers::Copy, data, nullptr, nelem, elsize, opts);
+
+  if (napi_create_typedarray(env, type, nelem, arraybuffer, 0, &value) != napi_ok)
+    throw std::runtime_error("Failed to create typed array.");
+  return value;
+}
+
+/**
+ * \brief Convert sparse matrix to {m, n, ir, jc, pr[, pi]} object with sparse property
+ * 
+ * Only the nonzero elements are transferred: ir (row indices) and pr (values) have
+ * nnz elements and jc (column offsets) has n+1. Logical matrix values are returned 
+ * as Uint8Array flagged logical. The imaginary part of complex matrix values is
+ * returned as pi or, if opts.interleaved_complex, interleaved in pr flagged complex.
+ */
+inline napi_value from_sparse(napi_env env, const mxArray *array, const MxArrayToNapiOptions &opts)
+{
+  size_t n = mxGetN(array);
+  mwIndex *jc = mxGetJc(array);
+  size_t nnz = jc[n];
+
+  napi_value rval, m_value, n_value;
+  if (napi_create_object(env, &rval) != napi_ok ||
+      napi_create_double(env, (double)mxGetM(array), &m_value) != napi_ok ||
+      napi_create_double(env, (double)n, &n_value) != napi_ok ||
+      napi_set_named_property(env, rval, "m", m_value) != napi_ok ||
+      napi_set_named_property(env, rval, "n", n_value) != napi_ok)
+    throw std::runtime_error("Failed to create JavaScript object for sparse matrix.");
+
+  napi_value ir_value = data_to_typedarray(env, mwindex_typedarray_type, mxGetIr(array), nnz, sizeof(mwIndex), opts);
+  napi_value jc_value = data_to_typedarray(env, mwindex_typedarray_type, jc, n + 1, sizeof(mwIndex), opts);
+  if (napi_set_named_property(env, rval, "ir", ir_value) != napi_ok ||
+      napi_set_named_property(env, rval, "jc", jc_value) != napi_ok)
+    throw std::runtime_error("Failed to set sparse matrix indices.");
+
+  napi_value pr_value, pi_value(nullptr);
+  if (mxIsLogical(array))
+  {
+    pr_value = data_to_typedarray(env, napi_uint8_array, mxGetData(array), nnz, sizeof(mxLogical), opts);
+    set_flag(env, pr_value, "logical");
+  }
+  else if (!mxIsComplex(array))
+  {
+    pr_value = data_to_typedarray(env, napi_float64_array, mxGetData(array), nnz, sizeof(double), opts);
+  }
+#if MX_HAS_INTERLEAVED_COMPLEX
+  else if (opts.interleaved_complex)
+  {
+    pr_value = data_to_typedarray(env, napi_float64_array, mxGetData(array), 2 * nnz, sizeof(double), opts);
+    set_flag(env, pr_value, "complex");
+  }
+  else
+  {
+    napi_value re = to_arraybuffer(env, MxArrayBuffers::RealPart, mxGetData(array), nullptr, nnz, sizeof(double), opts);
+    napi_value im = to_arraybuffer(env, MxArrayBuffers::ImagPart, mxGetData(array), nullptr, nnz, sizeof(double), opts);
+    if (napi_create_typedarray(env, napi_float64_array, nnz, re, 0, &pr_value) != napi_ok ||
+        napi_create_typedarray(env, napi_float64_array, nnz, im, 0, &pi_value) != napi_ok)
+      throw std::runtime_error("Failed to create typed array.");
+  }
+#else
+  else if (opts.interleaved_complex)
+  {
+    napi_value arraybuffer = to_arraybuffer(env, MxArrayBuffers::Interleaved, mxGetData(array), mxGetImagData(array),
+                                            nnz, sizeof(double), opts);
+    if (napi_create_typedarray(env, napi_float64_array, 2 * nnz, arraybuffer, 0, &pr_value) != napi_ok)
+      throw std::runtime_error("Failed to create typed array.");
+    set_flag(env, pr_value, "complex");
+  }
+  else
+  {
+    pr_value = data_to_typedarray(env, napi_float64_array, mxGetData(array), nnz, sizeof(double), opts);
+    pi_value = data_to_typedarray(env, napi_float64_array, mxGetImagData(array), nnz, sizeof(double), opts);
   }
+#endif
+
+  if (napi_set_named_property(env, rval, "pr", pr_value) != napi_ok ||
+      (pi_value && napi_set_named_property(env, rval, "pi", pi_value) != napi_ok))
+    throw std::runtime_error("Failed to set sparse matrix values.");
 
+  set_flag(env, rval, "sparse");
   return rval;
 }
 
+/**
+ * \brief Convert char array
+ * 
+ * A row vector becomes a string. A char matrix becomes an array of its row strings (columns 
+ * of N-D arrays are concatenated as mxGetN() does).
+ */
 inline napi_value from_chars(napi_env env, const mxArray *array) // char string
+{
+  // mxChar data are UTF-16 but not null-terminated: always pass the length
+  const char16_t *chars = reinterpret_cast<const char16_t *>(mxGetChars(array));
+  size_t m = mxGetM(array), n = mxGetN(array);
+
+  napi_value rval;
+  if (m <= 1)
+  {
+    if (napi_create_string_utf16(env, chars, m * n, &rval) != napi_ok)
+      throw std::runtime_error("Failed to create JavaScript string.");
+    return rval;
+  }
+
+  if (napi_create_array_with_length(env, m, &rval) != napi_ok)
+    throw std::runtime_error("Failed to create JavaScript array.");
+
+  std::u16string row(n, u'\0');
+  for (size_t i = 0; i < m; ++i)
+  {
+    for (size_t j = 0; j < n; ++j) // column-major -> row
+      row[j] = chars[i + j * m];
+
+    napi_value str;
+    if (napi_create_string_utf16(env, row.data(), n, &str) != napi_ok ||
+        napi_set_element(env, rval, (uint32_t)i, str) != napi_ok)
+      throw std::runtime_error("Failed to create JavaScript string.");
+  }
+  return rval;
+}
+
+/**
+ * \brief True if all cells hold char row vectors (or empty chars)
+ */
+inline bool is_cellstr(const mxArray *array)
+{
+  size_t nelem = mxGetNumberOfElements(array);
+  for (size_t i = 0; i < nelem; ++i)
+  {
+    const mxArray *cell = mxGetCell(array, i);
+    if (!cell || !mxIsChar(cell) || mxGetNumberOfDimensions(cell) != 2 || (mxGetM(cell) > 1 && !mxIsEmpty(cell)))
+      return false;
+  }
+  return true;
+}
+
+/**
+ * \brief Convert cellstr to an array of strings (empty chars become "")
+ */
+inline napi_value from_cellstr(napi_env env, const mxArray *array)
 {
   napi_value rval;
-  if (napi_create_string_utf16(env, mxGetChars(array), NAPI_AUTO_LENGTH, &rval) != napi_ok)
-    throw std::runtime_error("Failed to create JavaScript string.");
+  uint32_t nelem = (uint32_t)mxGetNumberOfElements(array);
+  if (napi_create_array_with_length(env, nelem, &rval) != napi_ok)
+    throw std::runtime_error("Failed to create JavaScript array.");
+
+  napi_handle_scope scope(nullptr);
+  for (uint32_t i = 0; i < nelem; ++i)
+  {
+    if (!(i % 1024)) // one handle scope per block of elements
+    {
+      if ((scope && napi_close_handle_scope(env, scope) != napi_ok) || napi_open_handle_scope(env, &scope) != napi_ok)
+        throw std::runtime_error("Failed to run napi_open_handle_scope()");
+    }
+
+    const mxArray *cell = mxGetCell(array, i);
+    napi_value str;
+    if (napi_create_string_utf16(env, reinterpret_cast<const char16_t *>(mxGetChars(cell)),
+                                 mxGetNumberOfElements(cell), &str) != napi_ok ||
+        napi_set_element(env, rval, i, str) != napi_ok)
+      throw std::runtime_error("Failed to create JavaScript string.");
+  }
+  if (scope && napi_close_handle_scope(env, scope) != napi_ok)
+    throw std::runtime_error("Failed to run napi_close_handle_scope()");
   return rval;
 }
 
-inline napi_value from_logicals(napi_env env, const mxArray *array)
+inline napi_value from_logicals(napi_env env, const mxArray *array, const MxArrayToNapiOptions &opts)
 {
   napi_value rval(nullptr);
   if (mxIsScalar(array))
@@ -208,15 +845,31 @@ inline napi_value from_logicals(napi_env env, const mxArray *array)
     if (napi_get_boolean(env, mxGetLogicals(array)[0], &rval) != napi_ok)
       throw std::runtime_error("Failed to create a boolean value.");
   }
-  else
+  else if (opts.pack_logicals) // bitset: element i is bit (i % 8) of byte (i / 8)
+  {
+    size_t nelem = mxGetNumberOfElements(array);
+    napi_value arraybuffer = to_arraybuffer(env, MxArrayBuffers::PackedBits, mxGetLogicals(array), nullptr, nelem,
+                                            sizeof(mxLogical), opts);
+
+    if (napi_create_typedarray(env, napi_uint8_array, (nelem + 7) / 8, arraybuffer, 0, &rval) != napi_ok)
+      throw std::runtime_error("Failed to create typed array.");
+    set_dims(env, rval, array);
+    set_flag(env, rval, "logical");
+    set_flag(env, rval, "packed");
+  }
+  else // one byte per element as in MATLAB
   {
-    throw std::runtime_error("Non-scalar logical variable is not currently supported.");
+    rval = to_typedarray<uint8_t, decltype(mxGetData) *>(env, napi_uint8_array, array, mxGetData, opts);
+    set_flag(env, rval, "logical");
   }
   return rval;
 }
 
-inline napi_value from_cell(napi_env env, const mxArray *array) // for a struct
+inline napi_value from_cell(napi_env env, const mxArray *array, const MxArrayToNapiOptions &opts) // for a struct
 {
+  if (is_cellstr(array))
+    return from_cellstr(env, array);
+
   napi_value rval;
 
   uint32_t nelem = (uint32_t)mxGetNumberOfElements(array);
@@ -224,51 +877,363 @@ inline napi_value from_cell(napi_env env, const mxArray *array) // for a struct
     throw std::runtime_error("Failed to create JavaScript array.");
   for (uint32_t i = 0; i < nelem; ++i) // recursively call from_struct() to populate each element
   {
-    if (napi_set_element(env, rval, i, mxArrayToNapiValue(env, mxGetCell(array, i))) != napi_ok)
+    if (napi_set_element(env, rval, i, mxArrayToNapiValue(env, mxGetCell(array, i), opts)) != napi_ok)
       throw std::runtime_error("Failed to set an JavaScript array element.");
   }
   return rval;
 }
 
-inline napi_value from_struct(napi_env env, const mxArray *array, int index) // for a cell
+/**
+ * \brief Create the property keys of the struct fields once for all the struct array elements
+ */
+inline std::vector<napi_value> struct_field_keys(napi_env env, const mxArray *array)
 {
-  napi_value rval;
+  int nfields = mxGetNumberOfFields(array);
+  std::vector<napi_value> keys(nfields);
+  for (int n = 0; n < nfields; ++n)
+    if (napi_create_string_utf8(env, mxGetFieldNameByNumber(array, n), NAPI_AUTO_LENGTH, &keys[n]) != napi_ok)
+      throw std::runtime_error("Failed to create JavaScript string.");
+  return keys;
+}
+
+inline napi_value from_struct(napi_env env, const mxArray *array, const MxArrayToNapiOptions &opts, int index,
+                              const std::vector<napi_value> *keys) // for a cell
+{
+  napi_value rval;
 
   if (index < 0 && mxIsScalar(array))
     index = 0;
+  else if (index < 0 && opts.columnar)
+    return from_struct_columns(env, array, opts);
 
   if (index >= 0)
   {
     if (napi_create_object(env, &rval) != napi_ok)
       throw std::runtime_error("Failed to create JavaScript object.");
 
-    int nfields = mxGetNumberOfFields(array);
+    std::vector<napi_value> local_keys;
+    if (!keys)
+    {
+      local_keys = struct_field_keys(env, array);
+      keys = &local_keys;
+    }
+
+    int nfields = (int)keys->size();
     for (int n = 0; n < nfields; ++n)
     {
-      if (napi_set_named_property(env, rval, mxGetFieldNameByNumber(array, n),
-                                  mxArrayToNapiValue(env, mxGetFieldByNumber(array, index, n))) != napi_ok)
+      if (napi_set_property(env, rval, (*keys)[n],
+                            mxArrayToNapiValue(env, mxGetFieldByNumber(array, index, n), opts)) != napi_ok)
         throw std::runtime_error("Failed to set JavaScript object property.");
     }
   }
   else // struct of array -> array of object
   {
+    std::vector<napi_value> shared_keys = struct_field_keys(env, array);
+
     int nelem = (int)mxGetNumberOfElements(array);
     if (napi_create_array_with_length(env, nelem, &rval) != napi_ok)
       throw std::runtime_error("Failed to create a JavaScript array.");
     for (int i = 0; i < nelem; ++i) // recursively call from_struct() to populate each element
     {
-      if (napi_set_element(env, rval, i, from_struct(env, array, i)) != napi_ok)
+      napi_handle_scope scope;
+      if (napi_open_handle_scope(env, &scope) != napi_ok)
+        throw std::runtime_error("Failed to run napi_open_handle_scope()");
+
+      if (napi_set_element(env, rval, i, from_struct(env, array, opts, i, &shared_keys)) != napi_ok)
         throw std::runtime_error("Failed to set JavaScript array element.");
+
+      if (napi_close_handle_scope(env, scope) != napi_ok)
+        throw std::runtime_error("Failed to run napi_close_handle_scope()");
     }
   }
   return rval;
 }
 
+/**
+ * \brief Common type of a struct array field
+ * 
+ * \returns class of the field values if all of them are real non-sparse scalars of the same 
+ *          numeric or logical class, mxCHAR_CLASS if all of them are character row vectors, 
+ *          or mxUNKNOWN_CLASS otherwise
+ */
+inline mxClassID struct_column_class(const mxArray *array, const int field)
+{
+  size_t nelem = mxGetNumberOfElements(array);
+  const mxArray *first = mxGetFieldByNumber(array, 0, field);
+  if (!first)
+    return mxUNKNOWN_CLASS;
+
+  mxClassID classid = mxGetClassID(first);
+  bool chars = classid == mxCHAR_CLASS;
+  if (!chars && !mxIsNumeric(first) && classid != mxLOGICAL_CLASS)
+    return mxUNKNOWN_CLASS;
+
+  for (size_t i = 0; i < nelem; ++i)
+  {
+    const mxArray *elem = mxGetFieldByNumber(array, i, field);
+    if (!elem || mxGetClassID(elem) != classid ||
+        (chars ? mxGetNumberOfDimensions(elem) != 2 || mxGetM(elem) > 1
+               : !mxIsScalar(elem) || mxIsComplex(elem) || mxIsSparse(elem)))
+      return mxUNKNOWN_CLASS;
+  }
+  return classid;
+}
+
+/**
+ * \brief Gather the scalar values of a struct array field into a typed array
+ */
+template <typename data_type>
+napi_value gather_struct_column(napi_env env, const mxArray *array, const int field, const napi_typedarray_type type)
+{
+  size_t nelem = mxGetNumberOfElements(array);
+
+  void *data;
+  napi_value arraybuffer, rval;
+  if (napi_create_arraybuffer(env, nelem * sizeof(data_type), &data, &arraybuffer) != napi_ok)
+    throw std::runtime_error("Failed to create JavaScript Array Buffer.");
+
+  data_type *dst = reinterpret_cast<data_type *>(data);
+  for (size_t i = 0; i < nelem; ++i)
+    dst[i] = *reinterpret_cast<const data_type *>(mxGetData(mxGetFieldByNumber(array, i, field)));
+
+  if (napi_create_typedarray(env, type, nelem, arraybuffer, 0, &rval) != napi_ok)
+    throw std::runtime_error("Failed to create typed array.");
+  return rval;
+}
+
+/**
+ * \brief Convert a struct array to an object of field columns
+ * 
+ * A field whose values are all scalars of one numeric or logical class becomes a typed array 
+ * (logical: Uint8Array with logical property) with the dims of the struct array, as attached 
+ * by from_numeric(), and a field of character row vectors becomes an array of strings. Any 
+ * other field becomes an array of the converted values. The dims property of the object also
+ * holds the dimensions of the struct array.
+ */
+inline napi_value from_struct_columns(napi_env env, const mxArray *array, const MxArrayToNapiOptions &opts)
+{
+  napi_value rval;
+  if (napi_create_object(env, &rval) != napi_ok)
+    throw std::runtime_error("Failed to create JavaScript object.");
+
+  uint32_t nelem = (uint32_t)mxGetNumberOfElements(array);
+  int nfields = mxGetNumberOfFields(array);
+  for (int n = 0; n < nfields; ++n)
+  {
+    napi_value column(nullptr);
+    mxClassID classid = struct_column_class(array, n);
+    switch (classid)
+    {
+    case mxDOUBLE_CLASS:
+      column = gather_struct_column<double>(env, array, n, napi_float64_array);
+      break;
+    case mxSINGLE_CLASS:
+      column = gather_struct_column<float>(env, array, n, napi_float32_array);
+      break;
+    case mxINT8_CLASS:
+      column = gather_struct_column<int8_t>(env, array, n, napi_int8_array);
+      break;
+    case mxUINT8_CLASS:
+      column = gather_struct_column<uint8_t>(env, array, n, napi_uint8_array);
+      break;
+    case mxINT16_CLASS:
+      column = gather_struct_column<int16_t>(env, array, n, napi_int16_array);
+      break;
+    case mxUINT16_CLASS:
+      column = gather_struct_column<uint16_t>(env, array, n, napi_uint16_array);
+      break;
+    case mxINT32_CLASS:
+      column = gather_struct_column<int32_t>(env, array, n, napi_int32_array);
+      break;
+    case mxUINT32_CLASS:
+      column = gather_struct_column<uint32_t>(env, array, n, napi_uint32_array);
+      break;
+    case mxINT64_CLASS:
+      column = gather_struct_column<int64_t>(env, array, n, napi_bigint64_array);
+      break;
+    case mxUINT64_CLASS:
+      column = gather_struct_column<uint64_t>(env, array, n, napi_biguint64_array);
+      break;
+    case mxLOGICAL_CLASS:
+      column = gather_struct_column<uint8_t>(env, array, n, napi_uint8_array);
+      set_flag(env, column, "logical");
+      break;
+    default: // array of strings or of generic values
+      if (napi_create_array_with_length(env, nelem, &column) != napi_ok)
+        throw std::runtime_error("Failed to create JavaScript array.");
+      for (uint32_t i = 0; i < nelem; ++i)
+      {
+        napi_handle_scope scope;
+        if (napi_open_handle_scope(env, &scope) != napi_ok)
+          throw std::runtime_error("Failed to open handle scope.");
+
+        const mxArray *elem = mxGetFieldByNumber(array, i, n);
+        napi_value value;
+        if (!elem) // unset field
+        {
+          if (napi_get_null(env, &value) != napi_ok)
+            throw std::runtime_error("Failed to create null JavaScript object");
+        }
+        else if (classid == mxCHAR_CLASS && mxIsEmpty(elem)) // '' -> "" rather than null
+        {
+          if (napi_create_string_utf8(env, "", 0, &value) != napi_ok)
+            throw std::runtime_error("Failed to create JavaScript string.");
+        }
+        else
+          value = mxArrayToNapiValue(env, elem, opts);
+
+        if (napi_set_element(env, column, i, value) != napi_ok)
+          throw std::runtime_error("Failed to set JavaScript array element.");
+        napi_close_handle_scope(env, scope);
+      }
+    }
+    if (classid != mxUNKNOWN_CLASS && classid != mxCHAR_CLASS) // typed array: reshapes as the struct array
+      set_dims(env, column, array);
+
+    if (napi_set_named_property(env, rval, mxGetFieldNameByNumber(array, n), column) != napi_ok)
+      throw std::runtime_error("Failed to set JavaScript object property.");
+  }
+
+  set_dims(env, rval, array);
+  return rval;
+}
+
+/**
+ * \brief Prepare the buffer of a block unless it is small or referenced instead (any thread)
+ */
+inline void prepare_buffer(MxArrayBuffers &buffers, const MxArrayBuffers::Layout layout, const void *src,
+                           const void *src2, const size_t nelem, const size_t elsize, const MxArrayToNapiOptions &opts)
+{
+  size_t byte_length = buffer_length(layout, nelem, elsize);
+  if (byte_length < MxArrayBuffers::min_bytes || (layout == MxArrayBuffers::Copy && !opts.copy))
+    return;
+  fill_buffer(buffers.add(src, layout, byte_length), layout, src, src2, nelem, elsize);
+}
+
+/**
+ * \brief Prepare the buffers of the (real or complex) data of a numeric or sparse array
+ */
+inline void prepare_data_buffers(MxArrayBuffers &buffers, const mxArray *array, const size_t nelem,
+                                 const MxArrayToNapiOptions &opts)
+{
+  size_t elsize = mxGetElementSize(array);
+#if MX_HAS_INTERLEAVED_COMPLEX
+  if (mxIsComplex(array)) // size of a complex element
+    elsize /= 2;
+#endif
+
+  if (!mxIsComplex(array))
+  {
+    prepare_buffer(buffers, MxArrayBuffers::Copy, mxGetData(array), nullptr, nelem, elsize, opts);
+  }
+#if MX_HAS_INTERLEAVED_COMPLEX
+  else if (opts.interleaved_complex)
+  {
+    prepare_buffer(buffers, MxArrayBuffers::Copy, mxGetData(array), nullptr, 2 * nelem, elsize, opts);
+  }
+  else
+  {
+    prepare_buffer(buffers, MxArrayBuffers::RealPart, mxGetData(array), nullptr, nelem, elsize, opts);
+    prepare_buffer(buffers, MxArrayBuffers::ImagPart, mxGetData(array), nullptr, nelem, elsize, opts);
+  }
+#else
+  else if (opts.interleaved_complex)
+  {
+    prepare_buffer(buffers, MxArrayBuffers::Interleaved, mxGetData(array), mxGetImagData(array), nelem, elsize, opts);
+  }
+  else
+  {
+    prepare_buffer(buffers, MxArrayBuffers::Copy, mxGetData(array), nullptr, nelem, elsize, opts);
+    prepare_buffer(buffers, MxArrayBuffers::Copy, mxGetImagData(array), nullptr, nelem, elsize, opts);
+  }
+#endif
+}
+
+/**
+ * \brief First phase of mxArrayToNapiValue(), which needs no JavaScript and may run on any thread
+ * 
+ * Fills buffers with the large typed array contents of array (and the arrays nested in it) as
+ * mxArrayToNapiValue() would with opts, so that it only has to wrap them when given buffers in 
+ * opts.buffers. array must not change in between.
+ */
+inline void prepare_mxarray_buffers(const mxArray *array, const MxArrayToNapiOptions &opts, MxArrayBuffers &buffers)
+{
+  if (mxIsEmpty(array))
+    return;
+
+  if (mxIsSparse(array))
+  {
+    size_t n = mxGetN(array);
+    const mwIndex *jc = mxGetJc(array);
+    prepare_buffer(buffers, MxArrayBuffers::Copy, mxGetIr(array), nullptr, jc[n], sizeof(mwIndex), opts);
+    prepare_buffer(buffers, MxArrayBuffers::Copy, jc, nullptr, n + 1, sizeof(mwIndex), opts);
+    prepare_data_buffers(buffers, array, jc[n], opts);
+    return;
+  }
+
+  size_t nelem = mxGetNumberOfElements(array);
+  switch (mxGetClassID(array))
+  {
+  case mxCELL_CLASS:
+    for (size_t i = 0; i < nelem; ++i)
+      if (const mxArray *cell = mxGetCell(array, i))
+        prepare_mxarray_buffers(cell, opts, buffers);
+    break;
+  case mxSTRUCT_CLASS:
+  {
+    int nfields = mxGetNumberOfFields(array);
+    for (size_t i = 0; i < nelem; ++i)
+      for (int k = 0; k < nfields; ++k)
+        if (const mxArray *field = mxGetFieldByNumber(array, i, k))
+          prepare_mxarray_buffers(field, opts, buffers);
+    break;
+  }
+  case mxLOGICAL_CLASS:
+    prepare_buffer(buffers, opts.pack_logicals ? MxArrayBuffers::PackedBits : MxArrayBuffers::Copy,
+                   mxGetLogicals(array), nullptr, nelem, sizeof(mxLogical), opts);
+    break;
+  case mxCHAR_CLASS: // strings are created on the JavaScript thread
+  case mxVOID_CLASS:
+  case mxFUNCTION_CLASS:
+  case mxUNKNOWN_CLASS:
+    break;
+  default: // numeric
+    prepare_data_buffers(buffers, array, nelem, opts);
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////
 ///   N-API value to Matlab mxArray helper functions
 
+/**
+ * \brief Convert string to a char row vector, copying the UTF-16 code units as they are
+ */
+inline mxArray *from_string(napi_env env, const napi_value value)
+{
+  size_t length;
+  if (napi_get_value_string_utf16(env, value, nullptr, 0, &length) != napi_ok)
+    throw std::runtime_error("Failed to get JavaScript string length.");
+  if (!length)
+    return mxCreateString("");
+
+  // N-API always null-terminates, so read into a buffer one unit longer than the mxChar data
+  std::u16string str(length, u'\0');
+  if (napi_get_value_string_utf16(env, value, str.data(), length + 1, &length) != napi_ok)
+    throw std::runtime_error("Failed to get JavaScript string.");
+
+  mwSize dims[2] = {1, length};
+  mxArray *rval = mxCreateCharArray(2, dims);
+  if (!rval)
+    throw std::runtime_error("Failed to create mxArray.");
+  std::copy_n(str.data(), length, reinterpret_cast<char16_t *>(mxGetChars(rval)));
+  return rval;
+}
+
 inline mxArray *from_object(napi_env env, const napi_value value)
 {
+  if (auto array = MatlabMxArray::Unwrap(env, value)) // MxArray object
+    return mxDuplicateArray(array.get());
+
   bool is_type;
   if (napi_is_array(env, value, &is_type) == napi_ok && is_type)
     return from_array(env, value);
@@ -276,6 +1241,10 @@ inline mxArray *from_object(napi_env env, const napi_value value)
   if (napi_is_typedarray(env, value, &is_type) == napi_ok && is_type)
     return from_typedarray(env, value);
 
+  napi_value data;
+  if (is_shaped_typedarray(env, value, data)) // {data: TypedArray, dims: [...]}
+    return from_typedarray(env, data, value);
+
   if (napi_is_arraybuffer(env, value, &is_type) == napi_ok && is_type)
     return from_arraybuffer(env, value);
 
@@ -288,6 +1257,10 @@ inline mxArray *from_object(napi_env env, const napi_value value)
   if (napi_is_error(env, value, &is_type) == napi_ok && is_type)
     throw std::runtime_error("Cannot convert JavaScript error object to MATLAB mxArray.");
 
+  // sparse matrix in compressed sparse column format (marked as by from_sparse())
+  if (napi_get_option_bool(env, value, "sparse", false))
+    return from_sparse_object(env, value);
+
   // plain object or a class constructor/instance -> value-only struct
 
   // get array of property names
@@ -324,18 +1297,19 @@ inline mxArray *from_object(napi_env env, const napi_value value)
   // create mxArray
   managedMxArray array(mxCreateStructMatrix(1, 1, nfields, fnames.data()), mxDestroyArray);
 
-  // populate fields
+  // populate fields (look up by the property keys and field numbers rather than by name again)
   for (uint32_t i = 0; i < nfields; ++i)
   {
     napi_handle_scope scope;
     if (napi_open_handle_scope(env, &scope) != napi_ok)
       throw std::runtime_error("Failed to run napi_open_handle_scope()");
 
-    napi_value pval;
-    if (napi_get_named_property(env, value, fnames[i], &pval) != napi_ok)
-      throw std::runtime_error("Failed to run napi_get_named_property()");
+    napi_value pname, pval;
+    if (napi_get_element(env, pnamevalues, i, &pname) != napi_ok ||
+        napi_get_property(env, value, pname, &pval) != napi_ok)
+      throw std::runtime_error("Failed to run napi_get_property()");
 
-    mxSetField(array.get(), 0, fnames[i], napiValueToMxArray(env, pval));
+    mxSetFieldByNumber(array.get(), 0, (int)i, napiValueToMxArray(env, pval));
 
     if (napi_close_handle_scope(env, scope) != napi_ok)
       throw std::runtime_error("Failed to run napi_close_handle_scope()");
@@ -345,8 +1319,171 @@ inline mxArray *from_object(napi_env env, const napi_value value)
   return rval;
 }
 
+/**
+ * \brief Shape of a (nested) JavaScript array guessed from its first elements
+ * 
+ * \param[out] dims Length of each nesting level, outermost first
+ * \param[out] leaf Type of the first innermost element
+ * \returns false if an array along the way is empty
+ * \throws std::runtime_error if the arrays are nested more than NestingGuard::max_depth 
+ *         levels deep, as an array which contains itself first is
+ */
+inline bool guess_array_shape(napi_env env, napi_value value, std::vector<mwSize> &dims, napi_valuetype &leaf)
+{
+  bool is_array = true;
+  while (is_array)
+  {
+    if (dims.size() == NestingGuard::max_depth)
+      NestingGuard::throw_too_deep();
+
+    uint32_t length;
+    if (napi_get_array_length(env, value, &length) != napi_ok)
+      throw std::runtime_error("Failed to run napi_get_array_length()");
+    if (!length)
+      return false;
+    dims.push_back(length);
+
+    if (napi_get_element(env, value, 0, &value) != napi_ok ||
+        napi_is_array(env, value, &is_array) != napi_ok)
+      throw std::runtime_error("Failed to run napi_get_element()");
+  }
+  if (napi_typeof(env, value, &leaf) != napi_ok)
+    throw std::runtime_error("Failed to get the type of the JavaScript value.");
+  return true;
+}
+
+/**
+ * \brief Copy the elements of a rectangular nested array of numbers, booleans or strings
+ * 
+ * Element a[i0][i1]...[ik] is stored at dst[i0 + i1*dims[0] + ...], i.e., the nesting 
+ * levels become the MATLAB dimensions. Strings are stored as new char arrays, which the
+ * caller must destroy if this fails.
+ * 
+ * \returns false if the array is not rectangular or has an element of another type
+ */
+template <typename data_type>
+bool fill_from_nested_array(napi_env env, const napi_value value, const std::vector<mwSize> &dims, const size_t level,
+                            data_type *dst, const size_t stride)
+{
+  uint32_t length;
+  if (napi_get_array_length(env, value, &length) != napi_ok)
+    throw std::runtime_error("Failed to run napi_get_array_length()");
+  if (length != dims[level])
+    return false;
+
+  const bool innermost = level + 1 == dims.size();
+  NapiHandleScope scope(env);
+  for (uint32_t i = 0; i < length; ++i)
+  {
+    if (i && !(i % 1024)) // one handle scope per block of elements
+      scope.reopen();
+
+    napi_value elem;
+    if (napi_get_element(env, value, i, &elem) != napi_ok)
+      throw std::runtime_error("Failed to run napi_get_element()");
+
+    bool ok;
+    if (innermost)
+    {
+      if constexpr (std::is_same<data_type, mxLogical>::value)
+      {
+        bool val;
+        ok = napi_get_value_bool(env, elem, &val) == napi_ok;
+        dst[i * stride] = val;
+      }
+      else if constexpr (std::is_same<data_type, mxArray *>::value)
+      {
+        napi_valuetype type;
+        ok = napi_typeof(env, elem, &type) == napi_ok && type == napi_string;
+        if (ok)
+          dst[i * stride] = from_string(env, elem);
+      }
+      else
+        ok = napi_get_value_double(env, elem, &dst[i * stride]) == napi_ok;
+    }
+    else
+    {
+      bool is_array;
+      ok = napi_is_array(env, elem, &is_array) == napi_ok && is_array &&
+           fill_from_nested_array(env, elem, dims, level + 1, dst + i * stride, stride * dims[level]);
+    }
+
+    if (!ok) // wrong element type or shape
+      return false;
+  }
+  return true;
+}
+
+/**
+ * \brief Convert a rectangular (nested) array of numbers, booleans or strings to a double, logical 
+ *        or cellstr array
+ * 
+ * \returns nullptr if the array is not homogeneous
+ */
+inline mxArray *from_homogeneous_array(napi_env env, const napi_value value)
+{
+  std::vector<mwSize> dims;
+  napi_valuetype leaf;
+  if (!guess_array_shape(env, value, dims, leaf) || (leaf != napi_number && leaf != napi_boolean && leaf != napi_string))
+    return nullptr;
+  if (dims.size() == 1) // column vector as for typed arrays
+    dims.push_back(1);
+
+  bool ok;
+  managedMxArray array(nullptr, mxDestroyArray);
+  if (leaf == napi_number)
+  {
+    array.reset(mxCreateNumericArray(dims.size(), dims.data(), mxDOUBLE_CLASS, mxREAL));
+    ok = fill_from_nested_array(env, value, dims, 0, reinterpret_cast<double *>(mxGetData(array.get())), 1);
+  }
+  else if (leaf == napi_string) // cellstr, filled in one pass
+  {
+    size_t nelem = 1;
+    for (mwSize d : dims)
+      nelem *= d;
+    std::vector<mxArray *> cells(nelem, nullptr);
+    auto destroy_cells = [&cells]() {
+      for (mxArray *cell : cells)
+        if (cell)
+          mxDestroyArray(cell);
+    };
+    try
+    {
+      ok = fill_from_nested_array(env, value, dims, 0, cells.data(), 1);
+    }
+    catch (...)
+    {
+      destroy_cells();
+      throw;
+    }
+    if (!ok)
+    {
+      destroy_cells();
+      return nullptr;
+    }
+    array.reset(mxCreateCellArray(dims.size(), dims.data()));
+    for (size_t i = 0; i < nelem; ++i)
+      mxSetCell(array.get(), i, cells[i]);
+  }
+  else
+  {
+    array.reset(mxCreateLogicalArray(dims.size(), dims.data()));
+    ok = fill_from_nested_array(env, value, dims, 0, mxGetLogicals(array.get()), 1);
+  }
+  return ok ? array.release() : nullptr;
+}
+
+/**
+ * \brief Convert JavaScript array
+ * 
+ * An array of numbers (booleans or strings), possibly nested to a rectangular shape, becomes 
+ * a double (logical or cellstr) array. Any other array becomes a cell column vector.
+ */
 inline mxArray *from_array(napi_env env, const napi_value value) // for cell
 {
+  if (mxArray *rval = from_homogeneous_array(env, value))
+    return rval;
+
   uint32_t length;
   if (napi_get_array_length(env, value, &length) != napi_ok)
     throw std::runtime_error("Failed to run napi_get_array_length()");
@@ -375,57 +1512,470 @@ inline mxArray *from_array(napi_env env, const napi_value value) // for cell
   return rval;
 }
 
-inline mxArray *from_typedarray(napi_env env, const napi_value value) // numeric vector
+/**
+ * \brief MATLAB class of the typed array elements
+ * 
+ * \returns mxUNKNOWN_CLASS if not supported
+ */
+inline mxClassID typedarray_class(const napi_typedarray_type type)
+{
+  switch (type)
+  {
+  case napi_int8_array:
+    return mxINT8_CLASS;
+  case napi_uint8_array:
+    return mxUINT8_CLASS;
+  case napi_int16_array:
+    return mxINT16_CLASS;
+  case napi_uint16_array:
+    return mxUINT16_CLASS;
+  case napi_int32_array:
+    return mxINT32_CLASS;
+  case napi_uint32_array:
+    return mxUINT32_CLASS;
+  case napi_float32_array:
+    return mxSINGLE_CLASS;
+  case napi_float64_array:
+    return mxDOUBLE_CLASS;
+  case napi_bigint64_array:
+    return mxINT64_CLASS;
+  case napi_biguint64_array:
+    return mxUINT64_CLASS;
+  case napi_uint8_clamped_array:
+  default:
+    return mxUNKNOWN_CLASS;
+  }
+}
+
+/**
+ * \brief Size in bytes of the typed array elements
+ */
+inline size_t typedarray_element_size(const napi_typedarray_type type)
 {
+  switch (type)
+  {
+  case napi_int16_array:
+  case napi_uint16_array:
+    return 2;
+  case napi_int32_array:
+  case napi_uint32_array:
+  case napi_float32_array:
+    return 4;
+  case napi_float64_array:
+  case napi_bigint64_array:
+  case napi_biguint64_array:
+    return 8;
+  default:
+    return 1;
+  }
+}
+
+/**
+ * \brief Convert typed array
+ * 
+ * \param[in] env   N-API context
+ * \param[in] value Typed array
+ * \param[in] shape Object whose dims property gives the array dimensions (default: value). 
+ *                  A column vector is created if it has no dims property.
+ */
+inline mxArray *from_typedarray(napi_env env, const napi_value value, napi_value shape) // numeric array
+{
+  if (!shape)
+    shape = value;
+
   napi_typedarray_type type;
   size_t length;
-  void *data;
+  void *data; // already offset by byte_offset
   napi_value arraybuffer;
   size_t byte_offset;
 
   if (napi_get_typedarray_info(env, value, &type, &length, &data, &arraybuffer, &byte_offset) != napi_ok)
     throw std::runtime_error("Failed to run napi_get_typedarray_info()");
 
-  mxArray *rval(nullptr);
+  // logical array as returned by from_logicals()
+  if (type == napi_uint8_array && napi_get_option_bool(env, value, "logical", false))
+    return from_logical_typedarray(env, value, shape, reinterpret_cast<const uint8_t *>(data), length);
 
-  switch (type)
+  mxClassID classid = typedarray_class(type);
+  if (classid == mxUNKNOWN_CLASS)
+    throw std::runtime_error("Unsupported typedarray type.");
+
+  // interleaved complex array as returned by from_numeric()
+  if (napi_get_option_bool(env, value, "complex", false))
+    return from_complex_typedarray(env, shape, classid, data, length);
+
+  // no need to zero-fill as it is overwritten in bulk
+  std::vector<mwSize> dims = get_dims(env, shape, length);
+  mxArray *rval = mxCreateUninitNumericArray(dims.size(), dims.data(), classid, mxREAL);
+  if (!rval)
+    throw std::runtime_error("Failed to create mxArray.");
+  std::copy_n((const uint8_t *)data, length * mxGetElementSize(rval), (uint8_t *)mxGetData(rval));
+  return rval;
+}
+
+/**
+ * \brief Get the dims property of a JavaScript object
+ * 
+ * \returns the dimensions or an empty vector if the property is not defined
+ */
+inline std::vector<mwSize> get_dims(napi_env env, const napi_value value)
+{
+  std::vector<mwSize> dims;
+  napi_value jsdims = napi_get_option(env, value, "dims");
+  if (!jsdims)
+    return dims;
+
+  uint32_t ndims;
+  if (napi_get_array_length(env, jsdims, &ndims) != napi_ok)
+    throw std::runtime_error("dims must be an array.");
+
+  dims.reserve(ndims);
+  for (uint32_t n = 0; n < ndims; ++n)
   {
-  case napi_int8_array:
-    rval = mxCreateNumericMatrix(length, 1, mxINT8_CLASS, mxREAL);
-    std::copy_n(((int8_t *)data) + byte_offset, length, (int8_t *)mxGetData(rval));
+    napi_value elem;
+    if (napi_get_element(env, jsdims, n, &elem) != napi_ok)
+      throw std::runtime_error("Failed to get a dims element.");
+    dims.push_back(value2uint32(env, elem, false));
+  }
+  return dims;
+}
+
+/**
+ * \brief Get the dims property of a JavaScript object, checked against the number of elements
+ * 
+ * \returns the dimensions or {nelem, 1} if the property is not defined
+ */
+inline std::vector<mwSize> get_dims(napi_env env, const napi_value value, const size_t nelem)
+{
+  std::vector<mwSize> dims = get_dims(env, value);
+  if (dims.empty())
+    return {nelem, 1};
+
+  size_t n = 1;
+  for (auto d : dims)
+    n *= d;
+  if (n != nelem)
+    throw std::runtime_error("dims does not match the number of array elements.");
+  return dims;
+}
+
+/**
+ * \brief Test for a {data: TypedArray, dims: [...]} object (no other properties)
+ * 
+ * \param[out] data The typed array
+ */
+inline bool is_shaped_typedarray(napi_env env, const napi_value value, napi_value &data)
+{
+  bool has_data, has_dims, is_typedarray;
+  napi_value names;
+  uint32_t nnames;
+  return napi_has_named_property(env, value, "data", &has_data) == napi_ok && has_data &&
+         napi_has_named_property(env, value, "dims", &has_dims) == napi_ok && has_dims &&
+         napi_get_property_names(env, value, &names) == napi_ok &&
+         napi_get_array_length(env, names, &nnames) == napi_ok && nnames == 2 &&
+         napi_get_named_property(env, value, "data", &data) == napi_ok &&
+         napi_is_typedarray(env, data, &is_typedarray) == napi_ok && is_typedarray;
+}
+
+/**
+ * \brief Convert a Uint8Array flagged as logical (optionally bit-packed) to a logical mxArray
+ * 
+ * The dims property, if present, gives the shape. Otherwise a column vector is created.
+ */
+inline mxArray *from_logical_typedarray(napi_env env, const napi_value value, const napi_value shape, const uint8_t *data, size_t length)
+{
+  bool packed = napi_get_option_bool(env, value, "packed", false);
+  std::vector<mwSize> dims = get_dims(env, shape);
+
+  size_t nelem = packed ? length * 8 : length;
+  if (dims.size())
+  {
+    size_t n = 1;
+    for (auto d : dims)
+      n *= d;
+    if (packed ? (n + 7) / 8 != length : n != nelem)
+      throw std::runtime_error("dims does not match the number of logical array elements.");
+    nelem = n;
+  }
+  else
+    dims = {nelem, 1};
+
+  mxArray *rval = mxCreateLogicalArray(dims.size(), dims.data());
+  if (!rval)
+    throw std::runtime_error("Failed to create mxArray.");
+
+  mxLogical *dst = mxGetLogicals(rval);
+  if (packed)
+    for (size_t i = 0; i < nelem; ++i)
+      dst[i] = (data[i >> 3] >> (i & 7)) & 1;
+  else
+    for (size_t i = 0; i < nelem; ++i)
+      dst[i] = data[i] != 0;
+  return rval;
+}
+
+template <typename data_type>
+void copy_interleaved_complex(const void *src, mxArray *array, const size_t nelem)
+{
+#if MX_HAS_INTERLEAVED_COMPLEX
+  std::copy_n(reinterpret_cast<const data_type *>(src), 2 * nelem, reinterpret_cast<data_type *>(mxGetData(array)));
+#else
+  deinterleave_complex(reinterpret_cast<const data_type *>(src), reinterpret_cast<data_type *>(mxGetData(array)),
+                       reinterpret_cast<data_type *>(mxGetImagData(array)), nelem);
+#endif
+}
+
+/**
+ * \brief Convert a typed array of interleaved complex data flagged as complex to a complex mxArray
+ * 
+ * The dims property, if present, gives the shape. Otherwise a column vector is created.
+ */
+inline mxArray *from_complex_typedarray(napi_env env, const napi_value shape, const mxClassID classid, const void *data, size_t length)
+{
+  if (length % 2)
+    throw std::runtime_error("Interleaved complex typed array must have an even length.");
+  size_t nelem = length / 2;
+
+  std::vector<mwSize> dims = get_dims(env, shape, nelem);
+
+  managedMxArray rval(mxCreateNumericArray(dims.size(), dims.data(), classid, mxCOMPLEX), mxDestroyArray);
+  if (!rval)
+    throw std::runtime_error("Failed to create mxArray.");
+
+  switch (classid)
+  {
+  case mxDOUBLE_CLASS:
+    copy_interleaved_complex<double>(data, rval.get(), nelem);
     break;
-  case napi_uint8_array:
-    rval = mxCreateNumericMatrix(length, 1, mxUINT8_CLASS, mxREAL);
-    std::copy_n(((uint8_t *)data) + byte_offset, length, (uint8_t *)mxGetData(rval));
+  case mxSINGLE_CLASS:
+    copy_interleaved_complex<float>(data, rval.get(), nelem);
     break;
-  case napi_int16_array:
-    rval = mxCreateNumericMatrix(length, 1, mxINT16_CLASS, mxREAL);
-    std::copy_n(((int16_t *)data) + byte_offset, length, (int16_t *)mxGetData(rval));
+  case mxINT8_CLASS:
+  case mxUINT8_CLASS:
+    copy_interleaved_complex<uint8_t>(data, rval.get(), nelem);
     break;
-  case napi_uint16_array:
-    rval = mxCreateNumericMatrix(length, 1, mxUINT16_CLASS, mxREAL);
-    std::copy_n(((int16_t *)data) + byte_offset, length, (uint16_t *)mxGetData(rval));
+  case mxINT16_CLASS:
+  case mxUINT16_CLASS:
+    copy_interleaved_complex<uint16_t>(data, rval.get(), nelem);
+    break;
+  case mxINT32_CLASS:
+  case mxUINT32_CLASS:
+    copy_interleaved_complex<uint32_t>(data, rval.get(), nelem);
     break;
+  default:
+    copy_interleaved_complex<uint64_t>(data, rval.get(), nelem);
+  }
+  return rval.release();
+}
+
+/**
+ * \brief Typed array property of a JavaScript object
+ */
+struct TypedArrayProperty
+{
+  napi_value value = nullptr;
+  napi_typedarray_type type = napi_float64_array;
+  size_t length = 0;
+  void *data = nullptr; // already offset by byte_offset
+};
+
+inline TypedArrayProperty get_typedarray_property(napi_env env, const napi_value object, const char *name,
+                                                  const bool required = true)
+{
+  TypedArrayProperty prop;
+  prop.value = napi_get_option(env, object, name);
+  if (!prop.value)
+  {
+    if (required)
+      throw std::runtime_error(std::string("Missing ") + name + " property.");
+    return prop;
+  }
+
+  bool is_typedarray;
+  napi_value arraybuffer;
+  size_t byte_offset;
+  if (napi_is_typedarray(env, prop.value, &is_typedarray) != napi_ok || !is_typedarray ||
+      napi_get_typedarray_info(env, prop.value, &prop.type, &prop.length, &prop.data, &arraybuffer, &byte_offset) != napi_ok)
+    throw std::runtime_error(std::string(name) + " must be a typed array.");
+  return prop;
+}
+
+template <typename src_type>
+void copy_indices(const void *src, mwIndex *dst, const size_t n)
+{
+  const src_type *p = reinterpret_cast<const src_type *>(src);
+  for (size_t i = 0; i < n; ++i)
+    dst[i] = static_cast<mwIndex>(p[i]);
+}
+
+/**
+ * \brief Copy an integer typed array to a MATLAB index array
+ */
+inline void copy_indices(const TypedArrayProperty &src, mwIndex *dst, const size_t n)
+{
+  if (sizeof(mwIndex) == 8 && (src.type == napi_bigint64_array || src.type == napi_biguint64_array))
+  {
+    std::copy_n(reinterpret_cast<const uint8_t *>(src.data), n * sizeof(mwIndex), reinterpret_cast<uint8_t *>(dst));
+    return;
+  }
+
+  switch (src.type)
+  {
   case napi_int32_array:
-    rval = mxCreateNumericMatrix(length, 1, mxINT32_CLASS, mxREAL);
-    std::copy_n(((int32_t *)data) + byte_offset, length, (int32_t *)mxGetData(rval));
+    copy_indices<int32_t>(src.data, dst, n);
     break;
   case napi_uint32_array:
-    rval = mxCreateNumericMatrix(length, 1, mxUINT32_CLASS, mxREAL);
-    std::copy_n(((uint32_t *)data) + byte_offset, length, (uint32_t *)mxGetData(rval));
+    copy_indices<uint32_t>(src.data, dst, n);
     break;
-  case napi_float32_array:
-    rval = mxCreateNumericMatrix(length, 1, mxSINGLE_CLASS, mxREAL);
-    std::copy_n(((float *)data) + byte_offset, length, (float *)mxGetData(rval));
+  case napi_bigint64_array:
+    copy_indices<int64_t>(src.data, dst, n);
+    break;
+  case napi_biguint64_array:
+    copy_indices<uint64_t>(src.data, dst, n);
     break;
   case napi_float64_array:
-    rval = mxCreateNumericMatrix(length, 1, mxDOUBLE_CLASS, mxREAL);
-    std::copy_n(((double *)data) + byte_offset, length, (double *)mxGetData(rval));
+    copy_indices<double>(src.data, dst, n);
     break;
-  case napi_uint8_clamped_array:
   default:
-    throw std::runtime_error("Unsupported typedarray type.");
+    throw std::runtime_error("Sparse matrix indices must be Int32Array, Uint32Array, BigInt64Array, BigUint64Array, or Float64Array.");
   }
+}
+
+/**
+ * \brief Check the indices of a sparse mxArray as MATLAB expects them
+ * 
+ * jc must start at 0 and not decrease, and the row indices of each column must be 
+ * strictly increasing and less than the number of rows.
+ * 
+ * \throws std::runtime_error if the indices are invalid
+ */
+inline void check_sparse_indices(const mwIndex *ir, const mwIndex *jc, const size_t m, const size_t n)
+{
+  if (jc[0] != 0)
+    throw std::runtime_error("Sparse matrix jc must start with 0.");
+  for (size_t j = 0; j < n; ++j)
+  {
+    if (jc[j + 1] < jc[j])
+      throw std::runtime_error("Sparse matrix jc must not decrease.");
+    for (mwIndex k = jc[j]; k < jc[j + 1]; ++k)
+    {
+      if (ir[k] >= m)
+        throw std::runtime_error("Sparse matrix ir has an out-of-range row index.");
+      if (k > jc[j] && ir[k] <= ir[k - 1])
+        throw std::runtime_error("Sparse matrix row indices must be increasing within each column.");
+    }
+  }
+}
+
+/**
+ * \brief Convert a {m, n, ir, jc, pr[, pi], sparse: true} object (see from_sparse()) to a sparse mxArray
+ */
+inline mxArray *from_sparse_object(napi_env env, const napi_value value)
+{
+  napi_value m_value = napi_get_option(env, value, "m"), n_value = napi_get_option(env, value, "n");
+  if (!m_value || !n_value)
+    throw std::runtime_error("Sparse matrix object must have m and n properties.");
+  size_t m = (size_t)value2double(env, m_value), n = (size_t)value2double(env, n_value);
+
+  TypedArrayProperty ir = get_typedarray_property(env, value, "ir");
+  TypedArrayProperty jc = get_typedarray_property(env, value, "jc");
+  TypedArrayProperty pr = get_typedarray_property(env, value, "pr");
+  TypedArrayProperty pi = get_typedarray_property(env, value, "pi", false);
+
+  if (jc.length != n + 1)
+    throw std::runtime_error("Sparse matrix jc must have n+1 elements.");
+  std::vector<mwIndex> colstarts(n + 1);
+  copy_indices(jc, colstarts.data(), n + 1);
+  size_t nnz = colstarts[n];
+  if (ir.length < nnz)
+    throw std::runtime_error("Sparse matrix ir has fewer than nnz elements.");
+  std::vector<mwIndex> rows(nnz);
+  copy_indices(ir, rows.data(), nnz);
+  check_sparse_indices(rows.data(), colstarts.data(), m, n);
+
+  bool logical = pr.type == napi_uint8_array && napi_get_option_bool(env, pr.value, "logical", false);
+  bool interleaved = napi_get_option_bool(env, pr.value, "complex", false);
+  bool complex = interleaved || pi.value;
+  if (!logical && pr.type != napi_float64_array)
+    throw std::runtime_error("Sparse matrix pr must be Float64Array or logical Uint8Array.");
+  if (pr.length < (interleaved ? 2 * nnz : nnz) || (pi.value && (pi.type != napi_float64_array || pi.length < nnz)))
+    throw std::runtime_error("Sparse matrix pr/pi have fewer than nnz elements.");
+
+  mwSize nzmax = nnz ? nnz : 1;
+  managedMxArray rval(logical ? mxCreateSparseLogicalMatrix(m, n, nzmax)
+                              : mxCreateSparse(m, n, nzmax, complex ? mxCOMPLEX : mxREAL),
+                      mxDestroyArray);
+  if (!rval)
+    throw std::runtime_error("Failed to create sparse mxArray.");
+
+  std::copy(rows.begin(), rows.end(), mxGetIr(rval.get()));
+  std::copy(colstarts.begin(), colstarts.end(), mxGetJc(rval.get()));
+
+  if (logical)
+  {
+    const uint8_t *src = reinterpret_cast<const uint8_t *>(pr.data);
+    mxLogical *dst = mxGetLogicals(rval.get());
+    for (size_t i = 0; i < nnz; ++i)
+      dst[i] = src[i] != 0;
+  }
+  else if (!complex)
+    std::copy_n(reinterpret_cast<const double *>(pr.data), nnz, reinterpret_cast<double *>(mxGetData(rval.get())));
+  else if (interleaved)
+    copy_interleaved_complex<double>(pr.data, rval.get(), nnz);
+  else
+  {
+#if MX_HAS_INTERLEAVED_COMPLEX
+    interleave_complex(reinterpret_cast<const double *>(pr.data), reinterpret_cast<const double *>(pi.data),
+                       reinterpret_cast<double *>(mxGetData(rval.get())), nnz);
+#else
+    std::copy_n(reinterpret_cast<const double *>(pr.data), nnz, reinterpret_cast<double *>(mxGetData(rval.get())));
+    std::copy_n(reinterpret_cast<const double *>(pi.data), nnz, reinterpret_cast<double *>(mxGetImagData(rval.get())));
+#endif
+  }
+
+  return rval.release();
+}
+
+/**
+ * \brief Create an uninitialized mxArray to be filled later from a shared typed array
+ * 
+ * A SharedArrayBuffer can be neither detached nor transferred, so its data stays in place 
+ * while a reference keeps the typed array alive and may be copied by another thread. 
+ * Returns an empty pointer, without allocating, unless value is a numeric typed array (not 
+ * logical or complex) backed by a SharedArrayBuffer and of at least min_bytes: the other
+ * typed arrays are copied by from_typedarray() on the calling thread. Otherwise, data and 
+ * bytes receive what is to be copied to mxGetData() of the returned array. The dimensions 
+ * are taken from the dims property of shape as in from_typedarray().
+ */
+inline managedMxArray create_for_shared_typedarray(napi_env env, const napi_value value, napi_value shape,
+                                                   const void *&data, size_t &bytes, const size_t min_bytes = 1 << 16)
+{
+  if (!shape)
+    shape = value;
+
+  napi_typedarray_type type;
+  size_t length;
+  void *ptr;
+  napi_value arraybuffer;
+  size_t byte_offset;
+  bool is_arraybuffer; // false for SharedArrayBuffer
+
+  if (napi_get_typedarray_info(env, value, &type, &length, &ptr, &arraybuffer, &byte_offset) != napi_ok ||
+      napi_is_arraybuffer(env, arraybuffer, &is_arraybuffer) != napi_ok)
+    throw std::runtime_error("Failed to run napi_get_typedarray_info()");
+
+  mxClassID classid = typedarray_class(type);
+  if (is_arraybuffer || classid == mxUNKNOWN_CLASS || napi_get_option_bool(env, value, "logical", false) ||
+      napi_get_option_bool(env, value, "complex", false) ||
+      length * typedarray_element_size(type) < min_bytes)
+    return managedMxArray(nullptr, mxDestroyArray);
+
+  std::vector<mwSize> dims = get_dims(env, shape, length);
+  managedMxArray rval(mxCreateUninitNumericArray(dims.size(), dims.data(), classid, mxREAL), mxDestroyArray);
+  if (!rval)
+    throw std::runtime_error("Failed to create mxArray.");
+  bytes = length * typedarray_element_size(type);
+  data = ptr;
   return rval;
 }
 
@@ -7,23 +7,31 @@
 
 #pragma once
 
+#include "matlab-addon-data.h"
+
 #include <mex.h>
 #include <node_api.h>
 
-#include <string>
 #include <map>
+#include <memory>
+#include <string>
 
 class MatlabEngine;
 
 /**
  * \brief Node.js class object wrapping MATLAB mxArray
  * 
- * 
+ * Keeps the array in the native heap, so it can be passed between the engine
+ * sessions (getVariable(name, {handle:true}) and putVariable(name, mxarray))
+ * and inspected without converting the whole array to JavaScript values.
  */
 class MatlabMxArray
 {
 public:
-  static napi_ref constructor;
+  /**
+ * \brief Reference to the MxArray class of the environment
+ */
+  static napi_ref &constructor(napi_env env) { return MatlabAddonData::Get(env).mxarray_constructor; }
 
   static napi_value Init(napi_env env, napi_value exports);
 
@@ -44,6 +52,22 @@ public:
 
   static void Destructor(napi_env env, void *nativeObject, void *finalize_hint);
 
+  /**
+   * \brief Create new MxArray JavaScript object wrapping the given array
+   *
+   * \param[in] env   The environment that the API is invoked under.
+   * \param[in] array mxArray to be owned by the new object (destroyed on failure)
+   * \returns the new MxArray object
+   */
+  static napi_value NewInstance(napi_env env, mxArray *array);
+
+  /**
+   * \brief Get the mxArray of an MxArray JavaScript object
+   *
+   * \returns the (shared) wrapped array or nullptr if value is not an MxArray object
+   */
+  static std::shared_ptr<mxArray> Unwrap(napi_env env, napi_value value);
+
   /**
    * \brief Constructor
    * 
@@ -63,15 +87,15 @@ public:
   ~MatlabMxArray();
 
 
-  bool setMxArray(mxArray *array); // will be responsible to destroy array
+  void setMxArray(mxArray *array); // will be responsible to destroy array
   const mxArray *getMxArray();     //
 
   napi_value getData(napi_env env); // Get mxArray content as a JavaScript data type
-  napi_status setData(napi_env env, napi_value data); // Set mxArray content from JavaScript object
+  void setData(napi_env env, napi_value data); // Set mxArray content from JavaScript object
   
 private:
-  mxArray *array_; // data array
-  std::map<void *, napi_ref> arraybuffers_;
+  std::shared_ptr<mxArray> array_;          // data array (shared with the external arraybuffers of its data)
+  std::map<void *, napi_ref> arraybuffers_; // weak references to the external arraybuffers
 
   napi_env env_;
   napi_ref wrapper_;
@@ -94,25 +118,6 @@ private:
   template <typename data_type, typename MxGetFun>
   napi_value numeric_to_ext_typedarray(napi_env env, const napi_typedarray_type type, MxGetFun mxGet);
 
-  napi_value to_value(napi_env env, const mxArray *array); // worker for GetData()
-  template <typename data_type, typename MxGetFun>
-  napi_value to_typedarray(napi_env env, const napi_typedarray_type type, const mxArray *array, MxGetFun mxGet); // logical scalar (or array with index arg)
-  template <typename data_type>
-  napi_value from_numeric(napi_env env, const mxArray *array, const napi_typedarray_type type); // logical scalar (or array with index arg)
-  napi_value from_chars(napi_env env, const mxArray *array);                                    // char string
-  napi_value from_logicals(napi_env env, const mxArray *array);                                 // numeric vector
-  napi_value from_cell(napi_env env, const mxArray *array);                                     // for a struct
-  napi_value from_struct(napi_env env, const mxArray *array, int index = -1);                   // for a cell
-
-  mxArray *from_value(napi_env env, const napi_value value);  // worker for GetData()
-  mxArray *from_object(napi_env env, const napi_value value); // for struct
-
-  mxArray *from_typedarray(napi_env, const napi_value value);  // numeric vector
-  mxArray *from_arraybuffer(napi_env, const napi_value value); // numeric vector
-  mxArray *from_buffer(napi_env, const napi_value value);      // numeric vector
-  mxArray *from_dataview(napi_env, const napi_value value);    // numeric vector
-  mxArray *from_array(napi_env env, const napi_value value);   // for cell
-
   static napi_value getData(napi_env env, napi_callback_info info); // Get mxArray content as a JavaScript data type
   static napi_value setData(napi_env env, napi_callback_info info); // Set mxArray content from JavaScript object
 
@@ -164,11 +169,11 @@ private:
   // static napi_value getProperty(napi_env env, napi_callback_info info);
   // static napi_value setProperty(napi_env env, napi_callback_info info);
 
-  // static napi_value isSparse(napi_env env, napi_callback_info info);
-  // static napi_value getNzmax(napi_env env, napi_callback_info info);
+  static napi_value isSparse(napi_env env, napi_callback_info info);
+  static napi_value getNzmax(napi_env env, napi_callback_info info);
   // static napi_value setNzmax(napi_env env, napi_callback_info info);
-  // static napi_value getIr(napi_env env, napi_callback_info info);
+  static napi_value getIr(napi_env env, napi_callback_info info); // copy of row indices of nonzero elements
   // static napi_value setIr(napi_env env, napi_callback_info info);
-  // static napi_value getJc(napi_env env, napi_callback_info info);
+  static napi_value getJc(napi_env env, napi_callback_info info); // copy of column offsets (n+1 elements)
   // static napi_value setJc(napi_env env, napi_callback_info info);
 };
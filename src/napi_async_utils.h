@@ -0,0 +1,269 @@
+#pragma once
+
+#include <node_api.h>
+
+#include <atomic>
+#include <string>
+#include <stdexcept>
+
+/**
+ * \brief Base class of a task whose work is done off the JavaScript thread
+ *
+ * execute() is called on a worker thread and must not use N-API. Once it
+ * returns, the task is handed back to the JavaScript thread by
+ * NapiTaskDispatcher where complete() creates the value to resolve the
+ * task's promise with. An exception thrown by either function rejects the
+ * promise instead.
+ */
+class NapiAsyncTask
+{
+public:
+  /**
+   * \brief Constructor
+   *
+   * \param[in] env          The environment that the API is invoked under.
+   * \param[in] make_promise True to create a promise to settle with the task outcome
+   */
+  explicit NapiAsyncTask(napi_env env, bool make_promise = true)
+      : deferred_(nullptr), promise_(nullptr), failed_(false), settled_(false)
+  {
+    if (make_promise && napi_create_promise(env, &deferred_, &promise_) != napi_ok)
+      throw std::runtime_error("Failed to create JavaScript promise.");
+  }
+
+  virtual ~NapiAsyncTask() {}
+
+  /**
+   * \brief Promise to be returned to JavaScript (only valid in the creating scope)
+   */
+  napi_value promise() const { return promise_; }
+
+  /**
+   * \brief Run the task on a worker thread
+   */
+  void run() noexcept
+  {
+    try
+    {
+      execute();
+    }
+    catch (std::exception &e)
+    {
+      fail(e.what());
+    }
+    catch (...)
+    {
+      fail("Unknown error occurred during asynchronous operation.");
+    }
+  }
+
+  /**
+   * \brief Complete the task on the JavaScript thread and settle its promise
+   */
+  void settle(napi_env env) noexcept
+  {
+    settle_promise(env);
+    cleanup(env);
+  }
+
+  /**
+   * \brief Reject the promise ahead of completion (JavaScript thread)
+   *
+   * For a task which is dropped before it runs: execute() still gets called
+   * and is expected to fail right away, and the outcome is then discarded by
+   * settle(), which only calls cleanup().
+   */
+  void reject(napi_env env, const std::string &msg) noexcept
+  {
+    napi_value jsmsg, error;
+    if (!deferred_ || settled_ ||
+        napi_create_string_utf8(env, msg.c_str(), NAPI_AUTO_LENGTH, &jsmsg) != napi_ok ||
+        napi_create_error(env, nullptr, jsmsg, &error) != napi_ok ||
+        napi_reject_deferred(env, deferred_, error) != napi_ok)
+      return;
+    fail(msg);
+    settled_ = true;
+  }
+
+  bool failed() const { return failed_; }
+  const std::string &error() const { return error_; }
+
+protected:
+  /**
+   * \brief Worker thread portion of the task
+   */
+  virtual void execute() = 0;
+
+  /**
+   * \brief JavaScript thread portion of the task
+   *
+   * Called after a successful execute(). If the task has no promise, it is
+   * called regardless and is responsible to check failed().
+   *
+   * \returns the value to resolve the promise with (nullptr for undefined)
+   */
+  virtual napi_value complete(napi_env /*env*/) { return nullptr; }
+
+  /**
+   * \brief Release JavaScript resources (must not throw)
+   *
+   * Called on the JavaScript thread after settling, regardless of the outcome.
+   */
+  virtual void cleanup(napi_env /*env*/) {}
+
+  void fail(const std::string &msg)
+  {
+    failed_ = true;
+    error_ = msg;
+  }
+
+private:
+  void settle_promise(napi_env env) noexcept
+  {
+    if (settled_) // by reject()
+      return;
+
+    napi_value value(nullptr);
+    if (!failed_ || !deferred_)
+    {
+      try
+      {
+        value = complete(env);
+      }
+      catch (std::exception &e)
+      {
+        fail(e.what());
+      }
+    }
+
+    if (!deferred_)
+      return;
+
+    if (failed_)
+    {
+      bool pending;
+      if (napi_is_exception_pending(env, &pending) == napi_ok && pending)
+        napi_get_and_clear_last_exception(env, &value);
+      else
+      {
+        napi_value msg;
+        napi_create_string_utf8(env, error_.c_str(), NAPI_AUTO_LENGTH, &msg);
+        napi_create_error(env, nullptr, msg, &value);
+      }
+      napi_reject_deferred(env, deferred_, value);
+    }
+    else
+    {
+      if (!value)
+        napi_get_undefined(env, &value);
+      napi_resolve_deferred(env, deferred_, value);
+    }
+  }
+
+  napi_deferred deferred_;
+  napi_value promise_;
+  bool failed_;
+  bool settled_; // promise rejected ahead by reject()
+  std::string error_;
+};
+
+/**
+ * \brief Hands NapiAsyncTask objects back to the JavaScript thread
+ *
+ * Wraps a thread-safe function which is referenced only while tasks are in
+ * flight, so that an idle dispatcher does not keep the event loop alive.
+ * Optionally pins the owning JavaScript object for the same duration.
+ */
+class NapiTaskDispatcher
+{
+public:
+  NapiTaskDispatcher() : tsfn_(nullptr), owner_(nullptr), pending_(0) {}
+
+  ~NapiTaskDispatcher() { release(); }
+
+  NapiTaskDispatcher(const NapiTaskDispatcher &) = delete;
+  NapiTaskDispatcher &operator=(const NapiTaskDispatcher &) = delete;
+
+  /**
+   * \brief Create the underlying thread-safe function
+   *
+   * \param[in] env   The environment that the API is invoked under.
+   * \param[in] owner (Weak) reference to the JavaScript object to keep alive
+   *                  while tasks are pending, or nullptr
+   * \param[in] name  Resource name for diagnostic tools
+   */
+  void init(napi_env env, napi_ref owner, const char *name)
+  {
+    napi_value resource_name;
+    if (napi_create_string_utf8(env, name, NAPI_AUTO_LENGTH, &resource_name) != napi_ok)
+      throw std::runtime_error("Failed to create resource name string.");
+
+    napi_threadsafe_function tsfn;
+    if (napi_create_threadsafe_function(env, nullptr, nullptr, resource_name, 0, 1, nullptr, nullptr,
+                                        this, NapiTaskDispatcher::call_js, &tsfn) != napi_ok)
+      throw std::runtime_error("Failed to create thread-safe function.");
+    tsfn_ = tsfn;
+
+    if (napi_unref_threadsafe_function(env, tsfn) != napi_ok)
+      throw std::runtime_error("Failed to unreference thread-safe function.");
+
+    owner_ = owner;
+  }
+
+  /**
+   * \brief Release the thread-safe function. Tasks completing afterwards are discarded.
+   */
+  void release()
+  {
+    if (napi_threadsafe_function tsfn = tsfn_.exchange(nullptr))
+      napi_release_threadsafe_function(tsfn, napi_tsfn_abort);
+  }
+
+  /**
+   * \brief Register a task about to be posted to a worker thread (JavaScript thread only)
+   */
+  void begin(napi_env env, NapiAsyncTask * /*task*/)
+  {
+    if (!tsfn_)
+      throw std::runtime_error("Asynchronous task dispatcher is not available.");
+
+    if (pending_++ == 0)
+    {
+      napi_ref_threadsafe_function(env, tsfn_);
+      if (owner_)
+        napi_reference_ref(env, owner_, nullptr);
+    }
+  }
+
+  /**
+   * \brief Return a finished task to the JavaScript thread (any thread)
+   */
+  void complete(NapiAsyncTask *task)
+  {
+    napi_threadsafe_function tsfn = tsfn_;
+    if (!tsfn || napi_call_threadsafe_function(tsfn, task, napi_tsfn_blocking) != napi_ok)
+      delete task; // JavaScript environment is going away
+  }
+
+private:
+  static void call_js(napi_env env, napi_value /*js_cb*/, void *context, void *data)
+  {
+    NapiTaskDispatcher *self = reinterpret_cast<NapiTaskDispatcher *>(context);
+    NapiAsyncTask *task = reinterpret_cast<NapiAsyncTask *>(data);
+
+    if (env)
+      task->settle(env);
+    delete task;
+
+    if (env && --self->pending_ == 0)
+    {
+      napi_unref_threadsafe_function(env, self->tsfn_);
+      if (self->owner_)
+        napi_reference_unref(env, self->owner_, nullptr);
+    }
+  }
+
+  std::atomic<napi_threadsafe_function> tsfn_; // released on the JavaScript thread while workers complete tasks
+  napi_ref owner_;
+  size_t pending_; // only accessed on the JavaScript thread
+};
@@ -10,6 +10,45 @@ template <typename T, int N>
 char (&dim_helper(T (&)[N]))[N];
 #define dim(x) (sizeof(dim_helper(x)))
 
+/**
+ * \brief Handle scope which is closed when it goes out of scope, also on an exception
+ */
+class NapiHandleScope
+{
+public:
+  explicit NapiHandleScope(napi_env env) : env_(env), scope_(nullptr) { open(); }
+  ~NapiHandleScope() { close(); }
+
+  NapiHandleScope(const NapiHandleScope &) = delete;
+  NapiHandleScope &operator=(const NapiHandleScope &) = delete;
+
+  /**
+   * \brief Close the scope and open a new one, releasing the handles created so far
+   */
+  void reopen()
+  {
+    close();
+    open();
+  }
+
+private:
+  void open()
+  {
+    if (napi_open_handle_scope(env_, &scope_) != napi_ok)
+      throw std::runtime_error("Failed to run napi_open_handle_scope()");
+  }
+
+  void close()
+  {
+    if (scope_)
+      napi_close_handle_scope(env_, scope_);
+    scope_ = nullptr;
+  }
+
+  napi_env env_;
+  napi_handle_scope scope_;
+};
+
 template <class T>
 struct NapiCBInfo
 {
@@ -46,6 +85,20 @@ NapiCBInfo<T> napi_get_cb_info(napi_env env, napi_callback_info info, size_t nar
   return NapiCBInfo<T>{jsthis, argv, obj, data};
 }
 
+/**
+  * \brief Retrieve JavaScript callback arguments of a variadic function
+  *
+  */
+template <class T>
+NapiCBInfo<T> napi_get_cb_info_varargs(napi_env env, napi_callback_info info, size_t nargmin)
+{
+  size_t argc = 0;
+  if (napi_get_cb_info(env, info, &argc, nullptr, nullptr, nullptr) != napi_ok)
+    throw std::runtime_error("Failed to call napi_get_cb_info() in napi_get_cb_info_varargs().");
+
+  return napi_get_cb_info<T>(env, info, nargmin, argc > nargmin ? argc : nargmin);
+}
+
 /**
  * \brief convert node.js string value to utf8-encoded std::string
  */
@@ -55,20 +108,16 @@ inline std::string napi_get_value_string_utf8(napi_env env, napi_value value)
   if (napi_coerce_to_string(env, value, &value) != napi_ok)
     throw std::runtime_error("Failed to execute napi_coerce_to_string()");
 
-  // get the string length from string property
-  napi_value val;
-  if (napi_get_named_property(env, value, "length", &val) != napi_ok)
-    throw std::runtime_error("Failed to execute napi_get_named_property()");
-
-  uint32_t len_u32;
-  if (napi_get_value_uint32(env, val, &len_u32) != napi_ok)
-    throw std::runtime_error("Failed to execute napi_get_value_uint32()");
+  // get the UTF-8 length (the length property counts UTF-16 code units, too few for non-ASCII text)
+  size_t length;
+  if (napi_get_value_string_utf8(env, value, nullptr, 0, &length) != napi_ok)
+    throw std::runtime_error("Failed to execute napi_get_value_string_utf8()");
 
   // create string buffer
-  size_t length;
-  std::string expr(len_u32 + 1, 0);
+  std::string expr(length + 1, 0);
   if (napi_get_value_string_utf8(env, value, expr.data(), expr.size(), &length) != napi_ok)
     throw std::runtime_error("Failed to execute napi_get_value_string_utf8()");
+  expr.resize(length); // drop the terminating null character
 
   return expr;
 }
@@ -81,7 +130,7 @@ inline bool value2bool(napi_env env, napi_value value, bool coerce = true)
   {
     napi_value coerced;
     if (napi_coerce_to_bool(env, value, &coerced) == napi_ok)
-      status = napi_get_value_bool(env, value, &rval);
+      status = napi_get_value_bool(env, coerced, &rval);
   }
   if (status != napi_ok)
     throw std::runtime_error("Failed to convert a JavaScript object to bool.");
@@ -96,7 +145,7 @@ inline uint32_t value2uint32(napi_env env, napi_value value, bool coerce = true)
   {
     napi_value coerced;
     if (napi_coerce_to_number(env, value, &coerced) == napi_ok)
-      status = napi_get_value_uint32(env, value, &rval);
+      status = napi_get_value_uint32(env, coerced, &rval);
   }
   if (status != napi_ok)
     throw std::runtime_error("Failed to convert a JavaScript object to uint32.");
@@ -111,9 +160,54 @@ inline double value2double(napi_env env, napi_value value, bool coerce = true)
   {
     napi_value coerced;
     if (napi_coerce_to_number(env, value, &coerced) == napi_ok)
-      status = napi_get_value_double(env, value, &rval);
+      status = napi_get_value_double(env, coerced, &rval);
   }
   if (status != napi_ok)
     throw std::runtime_error("Failed to convert a JavaScript object to double.");
   return rval;
 }
+
+/**
+ * \brief Get an optional property of an options object
+ * 
+ * \returns nullptr if opts is not given or the property is not defined
+ */
+inline napi_value napi_get_option(napi_env env, napi_value opts, const char *name)
+{
+  napi_valuetype type;
+  if (!opts || napi_typeof(env, opts, &type) != napi_ok || type != napi_object)
+    return nullptr;
+
+  napi_value value;
+  if (napi_get_named_property(env, opts, name, &value) != napi_ok ||
+      napi_typeof(env, value, &type) != napi_ok)
+    throw std::runtime_error("Failed to retrieve an option value.");
+  return type == napi_undefined ? nullptr : value;
+}
+
+/**
+ * \brief Get an optional boolean property of an options object
+ */
+inline bool napi_get_option_bool(napi_env env, napi_value opts, const char *name, bool defval)
+{
+  napi_value value = napi_get_option(env, opts, name);
+  return value ? value2bool(env, value) : defval;
+}
+
+/**
+ * \brief Get an optional uint32 property of an options object
+ */
+inline uint32_t napi_get_option_uint32(napi_env env, napi_value opts, const char *name, uint32_t defval)
+{
+  napi_value value = napi_get_option(env, opts, name);
+  return value ? value2uint32(env, value) : defval;
+}
+
+/**
+ * \brief Get an optional string property of an options object
+ */
+inline std::string napi_get_option_string(napi_env env, napi_value opts, const char *name, const std::string &defval)
+{
+  napi_value value = napi_get_option(env, opts, name);
+  return value ? napi_get_value_string_utf8(env, value) : defval;
+}
@@ -27,6 +27,10 @@ console.log(session.buffer);
 var x = session.getVariable("x");
 console.log(x);
 
+session.evalSync("A = reshape(1:24, 2, 3, 4)");
+var A = session.getVariable("A");
+console.log(A.length + ' elements, dims = ' + A.dims);
+
 session.putVariable("y", "test string");
 console.log(session.getVariable("y"));
 
@@ -35,6 +39,81 @@ var s = session.getVariable("s");
 console.log(s);
 session.putVariable("s1",s);
 
+session.evalSync("mask = A > 12");
+var mask = session.getVariable("mask");
+var bits = session.getVariable("mask", {packLogicals: true});
+console.log('logical mask: ' + mask.length + ' bytes, packed ' + bits.length + ' bytes, dims = ' + bits.dims);
+session.putVariable("mask2", bits);
+session.evalSync("assert(isequal(mask, mask2))");
+
+session.evalSync("t = int64(1600000000000000000) + int64(0:4)'");
+var t = session.getVariable("t");
+console.log('int64 timestamps: ' + t.constructor.name + ' [' + t + ']');
+session.putVariable("t2", t);
+session.evalSync("assert(isequal(t, t2))");
+
+session.evalSync("z = fft(1:8)");
+var z = session.getVariable("z", {interleavedComplex: true});
+console.log('interleaved complex: ' + z.length + ' values, dims = ' + z.dims);
+session.putVariable("z2", z);
+session.evalSync("assert(isequal(z, z2))");
+
+session.evalSync("S = sprand(1000, 1000, 0.01)");
+var S = session.getVariable("S");
+console.log('sparse CSC: ' + S.m + 'x' + S.n + ', nnz = ' + S.pr.length + ', ir ' + S.ir.constructor.name);
+session.putVariable("S2", S);
+session.evalSync("assert(issparse(S2) && isequal(S, S2))");
+session.putVariable("notS", {ir: 1, jc: 2}); // no sparse marker: a plain struct
+session.evalSync("assert(isstruct(notS))");
+try {
+  session.putVariable("badS", {m: 2, n: 1, ir: new Int32Array([1, 0]), jc: new Int32Array([0, 2]), pr: new Float64Array(2), sparse: true});
+  console.error('unsorted sparse row indices accepted');
+} catch (err) {
+  console.log('invalid sparse rejected: ' + err.message);
+}
+
+session.evalSync("recs = struct('id', num2cell(int32(1:1000)), 'price', num2cell(rand(1,1000)), 'name', 'item')");
+var cols = session.getVariable("recs", {columnar: true});
+console.log('columnar struct: id ' + cols.id.constructor.name + ', price ' + cols.price.constructor.name +
+  ', name ' + cols.name.length + ' strings, dims = ' + cols.dims);
+session.evalSync("grid = reshape(recs(1:6), 2, 3)");
+session.putVariable("gridprice", session.getVariable("grid", {columnar: true}).price);
+session.evalSync("assert(isequal(size(gridprice), [2 3]))"); // typed columns keep the struct array shape
+
+session.putVariable("v", Array.from({length: 1e6}, (_, i) => i));
+session.putVariable("M", [[1, 2, 3], [4, 5, 6]]);
+session.putVariable("b", [true, false, true]);
+session.putVariable("c", ["abc", "de"]);
+session.putVariable("C2", [["a", "b"], ["c", "d"]]);
+session.evalSync("assert(isequal(v, (0:1e6-1)') && isequal(M, [1 2 3; 4 5 6]) && islogical(b) && iscellstr(c))");
+
+var cyclic = [1];
+cyclic.push(cyclic);
+try {
+  session.putVariable("cyc", cyclic);
+  console.error('self-referencing array accepted');
+} catch (err) {
+  console.log('self-referencing array rejected: ' + err.message);
+}
+session.evalSync("assert(isequal(C2, {'a' 'b'; 'c' 'd'}))");
+
+session.evalSync("V = rand(4, 3, 2)");
+var V = session.getVariable("V");
+session.putVariable("V2", V);
+session.putVariable("V3", {data: V, dims: [4, 6]});
+session.evalSync("assert(isequal(V, V2) && isequal(reshape(V, 4, 6), V3))");
+
+session.putVariable("u", "h\u00e9llo \u4e16\u754c");
+session.evalSync("assert(isequal(u, ['h' char(233) 'llo ' char([19990 30028])]))");
+session.evalSync("cm = ['abc'; 'def']; cs = {'x', '', 'yz'}");
+console.log('char matrix rows: ' + JSON.stringify(session.getVariable("cm")) +
+  ', cellstr: ' + JSON.stringify(session.getVariable("cs")));
+
+var h = session.getVariable("A", {handle: true});
+console.log('MxArray handle: dims = ' + h.getDimensions() + ', isDouble = ' + h.isDouble());
+session.putVariable("B", h);
+session.evalSync("assert(isequal(A,B))");
+
 session.close();
 console.log('Matlab closed');
 
@@ -0,0 +1,122 @@
+const {Engine: Matlab} = require('../index.js');
+
+var session = new Matlab();
+
+// the event loop keeps ticking while MATLAB is busy
+var ticks = 0;
+var timer = setInterval(() => { ++ticks; }, 100);
+
+session.eval("pause(2); x = 5")
+  .then((output) => {
+    console.log('eval output: ' + output);
+    console.log('event loop ticked ' + ticks + ' times during eval');
+    console.log(session.getVariable("x"));
+
+    // queued calls run in order on the engine's worker thread
+    return Promise.all([session.eval("y = x + 1"), session.eval("z = y * 2")]);
+  })
+  .then(() => {
+    console.log(session.getVariable("z"));
+    return session.eval("error('should not reject: engine reports errors in its output')");
+  })
+  .then((output) => {
+    console.log(output);
+
+    // m-function call: a variable of the same name does not shadow the function, and ans is kept
+    session.evalSync('max = 0; ans = 42;');
+    return session.feval('max', 2, [3, 9, 4]);
+  })
+  .then(([m, i]) => {
+    console.log('max = ' + m + ' at ' + i);
+    console.log(session.fevalSync('upper', 1, 'abc'));
+    session.fevalSync('sqrt', 0, 4);
+    console.log('ans after feval: ' + session.getVariable('ans'));
+    session.evalSync('clear max ans');
+    return session.feval('no_such_function', 1);
+  })
+  .then(() => console.error('feval of an unknown function should reject'),
+        (err) => console.log('feval rejected: ' + err.message))
+  .then(() => {
+    // output is also emitted as one 'output' event (once MATLAB returns it)
+    var chunks = [];
+    const onOutput = (chunk) => chunks.push(chunk);
+    session.on('output', onOutput);
+    return session.eval("for k = 1:5, fprintf('step %d\\n', k); end")
+      .then((output) => {
+        session.off('output', onOutput);
+        if (chunks.length !== 1 || chunks[0] !== output) console.error('output event does not match eval output');
+      });
+  })
+  .then(() => {
+    // many small variables in one call each way
+    var vars = {};
+    for (let i = 0; i < 30; ++i) vars['v' + i] = i;
+    return session.putVariables(vars)
+      .then(() => session.getVariables(Object.keys(vars)))
+      .then((vals) => {
+        console.log('getVariables: v29 = ' + vals.v29);
+        session.putVariablesSync({a: 'text', b: [1, 2, 3]});
+        console.log(session.getVariablesSync(['a', 'b']));
+      });
+  })
+  .then(() => {
+    // pipelined calls: queued without waiting, quiet evals merged into few round trips
+    session.bufferEnabled = false;
+    const t0 = Date.now();
+    const done = [session.putVariableAsync('p', 0)];
+    for (let i = 0; i < 200; ++i) done.push(session.eval('p = p + 1;'));
+    // an error in a merged batch rejects only its own evaluation
+    const failed = session.eval('error(\'njs:test\', \'bad %d\', p)')
+      .then(() => 'not rejected', (err) => err.message);
+    done.push(session.eval('p = p + 1;'));
+    done.push(failed);
+    done.push(session.getVariableAsync('p'));
+    return Promise.all(done).then((results) => {
+      session.bufferEnabled = true;
+      console.log('pipelined: p = ' + results[results.length - 1] + ' in ' + (Date.now() - t0) + ' ms, error: ' +
+        results[results.length - 2]);
+    });
+  })
+  .then(() => {
+    // large arrays: filled off the JavaScript thread, which only wraps them
+    // (put without a copy on this thread only from a SharedArrayBuffer)
+    const big = new Float64Array(new SharedArrayBuffer(8 << 22));
+    big.forEach((_, i) => (big[i] = i));
+    return session.putVariableAsync('big', big, {copy: false})
+      .then(() => session.eval('big = complex(big, -big);'))
+      .then(() => session.getVariableAsync('big', {interleavedComplex: true}))
+      .then((value) => console.log('big: length = ' + value.length + ', last = ' + value.slice(-2)));
+  })
+  .then(() => {
+    // runaway evaluations: rejected on timeout or abort, session recovers for the next call
+    const t0 = Date.now();
+    return session.eval('pause(30)', {timeout: 1000})
+      .then(() => console.error('timeout did not fire'),
+            (err) => console.log('timeout: ' + err.message + ' after ' + (Date.now() - t0) + ' ms'))
+      .then(() => {
+        const ac = new AbortController();
+        setTimeout(() => ac.abort(), 500);
+        return session.eval('while true, end', {signal: ac.signal})
+          .then(() => console.error('abort did not fire'), (err) => console.log('abort: ' + err.message));
+      })
+      .then(() => {
+        // aborting a queued evaluation rejects it without waiting for the running one
+        const ac = new AbortController();
+        const running = session.eval('pause(2)');
+        const t0 = Date.now();
+        const queued = session.eval('y = 1;', {signal: ac.signal});
+        ac.abort();
+        return queued
+          .then(() => console.error('queued abort did not fire'),
+                (err) => console.log('queued abort: ' + err.message + ' after ' + (Date.now() - t0) + ' ms'))
+          .then(() => running);
+      })
+      .then(() => session.eval('x = 1 + 1;'))
+      .then(() => console.log('recovered: isOpen = ' + session.isOpen));
+  })
+  .catch((err) => console.error(err))
+  .finally(() => {
+    clearInterval(timer);
+    session.close();
+    console.log('Matlab closed');
+  });
@@ -16,6 +16,15 @@ console.log('session.buffer=' + session.buffer);
 console.log('session.bufferEnabled=' + session.bufferEnabled);
 console.log('session.bufferSize=' + session.bufferSize);
 
+// shared sessions: one MATLAB process behind both objects
+var shared1 = new matlab({shared: true});
+var shared2 = new matlab({shared: true});
+shared1.putVariable('sharedVar', 42);
+console.log('shared2 sees sharedVar=' + shared2.getVariable('sharedVar'));
+shared1.close(); // shared2 keeps the session open
+console.log('shared2 after shared1.close(): sharedVar=' + shared2.getVariable('sharedVar'));
+shared2.close();
+
 console.log('Pause 3 seconds before closing Matlab');
 setTimeout(() => {
   session.visible = true;
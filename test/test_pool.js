@@ -0,0 +1,39 @@
+const {EnginePool} = require('../index.js');
+
+// engines start in parallel in the background
+var pool = new EnginePool(2);
+console.log('pool.size=' + pool.size);
+
+async function job(id) {
+  const session = await pool.acquire();
+  try {
+    await session.eval('x = ' + id);
+    console.log('job ' + id + ': x=' + session.getVariable('x'));
+  } finally {
+    pool.release(session); // workspace is cleared before the next lease
+  }
+}
+
+Promise.all([1, 2, 3, 4].map(job))
+  .then(async () => {
+    const session = await pool.acquire();
+    console.log('workspace after reset: ' + session.evalSync('who'));
+    session.close(); // pool restarts the engine on release
+    pool.release(session);
+    console.log('pool.available=' + pool.available);
+  })
+  .then(async () => {
+    // a session garbage collected without release() returns to the pool (run with --expose-gc)
+    if (typeof global.gc !== 'function') return;
+    await pool.acquire();
+    await new Promise((resolve) => setImmediate(resolve));
+    global.gc();
+    const sessions = await Promise.all([pool.acquire(), pool.acquire()]);
+    console.log('collected session returned to the pool');
+    sessions.forEach((session) => pool.release(session));
+  })
+  .catch((err) => console.error(err))
+  .finally(() => {
+    pool.close();
+    console.log('pool closed');
+  });
@@ -0,0 +1,25 @@
+const {Engine: Matlab} = require('../index.js');
+
+var src = new Matlab();
+var dst = new Matlab();
+
+src.evalSync("s = struct('a', magic(4), 'b', {{'x', 1:3}}, 'c', struct('d', rand(100)))");
+
+// the variable goes from one engine to the other without JavaScript conversion
+var t0 = Date.now();
+src.transferTo(dst, 's', 't')
+  .then(() => {
+    console.log('transferTo took ' + (Date.now() - t0) + ' ms');
+    dst.putVariable('s', src.getVariable('s', {handle: true}));
+    dst.evalSync("assert(isequal(s, t))");
+    console.log('transferred struct matches');
+    return src.transferTo(dst, 'no_such_variable');
+  })
+  .then(() => console.error('transfer of an unknown variable should reject'),
+        (err) => console.log('transferTo rejected: ' + err.message))
+  .catch((err) => console.error(err))
+  .finally(() => {
+    src.close();
+    dst.close();
+    console.log('Matlab closed');
+  });
@@ -0,0 +1,39 @@
+const {Worker, isMainThread, parentPort, workerData} = require('worker_threads');
+
+if (isMainThread) {
+  // each worker thread loads its own instance of the addon and drives its own MATLAB
+  const jobs = [1, 2].map(
+    (id) =>
+      new Promise((resolve, reject) => {
+        const worker = new Worker(__filename, {workerData: id});
+        worker.on('message', (msg) => console.log('worker ' + id + ': ' + msg));
+        worker.on('error', reject);
+        worker.on('exit', resolve);
+      })
+  );
+
+  // a worker terminated with its engine busy shuts down cleanly, without waiting for MATLAB
+  const busy = new Worker(__filename, {workerData: 0});
+  let t0;
+  busy.on('message', () => {
+    t0 = Date.now();
+    busy.terminate();
+  });
+  jobs.push(new Promise((resolve) => busy.on('exit', resolve)).then(() => console.log('busy worker exited in ' + (Date.now() - t0) + ' ms')));
+
+  Promise.all(jobs)
+    .then(() => console.log('all workers exited'))
+    .catch((err) => console.error(err));
+} else {
+  const {Engine} = require('../index.js');
+  const session = new Engine();
+  if (workerData) {
+    session.evalSync('x = ' + workerData + ' * 10;');
+    parentPort.postMessage('x=' + session.getVariable('x'));
+    session.close();
+  } else {
+    session.eval('pause(30)');
+    session.eval('pause(30)');
+    parentPort.postMessage('busy');
+  }
+}